@@ -0,0 +1,78 @@
+# profile guided build, run by the pgo target with cmake -P
+# builds an instrumented engine, trains it on the bench and the perft suite, rebuilds it with the profile
+# and compares the bench speed with the regular build
+#
+# expects SOURCE_DIR, BINARY_DIR, COMPILER_ID, CXX_COMPILER, NATIVE_ARCH, MULTI_ISA, PROFDATA (clang only) and ENGINE (the regular binary)
+
+set(PGO_DIR "${BINARY_DIR}/pgo")
+set(PROFILE_DIR "${BINARY_DIR}/pgo-profile")
+set(PGO_ENGINE "${BINARY_DIR}/ciorap-bot-03-pgo${CMAKE_EXECUTABLE_SUFFIX}")
+
+# gcc finds its profiles next to the objects, so both builds happen in the same directory
+if(COMPILER_ID STREQUAL "GNU")
+    set(GENERATE_FLAGS "-fprofile-generate -fprofile-update=atomic")
+    set(USE_FLAGS "-fprofile-use -fprofile-correction -Wno-missing-profile")
+elseif(COMPILER_ID MATCHES "Clang" AND PROFDATA)
+    set(GENERATE_FLAGS "-fprofile-generate=${PROFILE_DIR}")
+    set(USE_FLAGS "-fprofile-use=${PROFILE_DIR}/engine.profdata -Wno-profile-instr-unprofiled")
+else()
+    message(FATAL_ERROR "profile guided builds need gcc, or clang with llvm-profdata")
+endif()
+
+function(run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "failed: ${ARGN}")
+    endif()
+endfunction()
+
+function(build_engine flags)
+    run(${CMAKE_COMMAND} -S "${SOURCE_DIR}" -B "${PGO_DIR}" -DCMAKE_BUILD_TYPE=Release
+        "-DCMAKE_CXX_COMPILER=${CXX_COMPILER}" "-DCMAKE_CXX_FLAGS=${flags}" "-DNATIVE_ARCH=${NATIVE_ARCH}" "-DMULTI_ISA=${MULTI_ISA}")
+    run(${CMAKE_COMMAND} --build "${PGO_DIR}" --target ciorap-bot-03 --clean-first)
+endfunction()
+
+# returns the nps of a bench run of the given engine
+function(bench_nps engine result)
+    execute_process(COMMAND "${engine}" bench OUTPUT_VARIABLE output)
+    string(REGEX MATCH "nps ([0-9]+)" match "${output}")
+    set(${result} "${CMAKE_MATCH_1}" PARENT_SCOPE)
+endfunction()
+
+message(STATUS "pgo: building the instrumented engine")
+file(REMOVE_RECURSE "${PROFILE_DIR}")
+file(GLOB_RECURSE OLD_PROFILES "${PGO_DIR}/*.gcda")
+if(OLD_PROFILES)
+    file(REMOVE ${OLD_PROFILES})
+endif()
+build_engine("${GENERATE_FLAGS}")
+
+# the suite doesn't use the perft hash table, so it trains move generation and make/unmake like the search does,
+# at depth 4 the bench is still most of the profile
+message(STATUS "pgo: training on the bench and the perft suite")
+run("${PGO_DIR}/ciorap-bot-03" bench)
+run("${PGO_DIR}/ciorap-bot-03" perftsuite "${SOURCE_DIR}/perft.epd" 4)
+
+if(COMPILER_ID MATCHES "Clang")
+    file(GLOB RAW_PROFILES "${PROFILE_DIR}/*.profraw")
+    run("${PROFDATA}" merge "-output=${PROFILE_DIR}/engine.profdata" ${RAW_PROFILES})
+endif()
+
+message(STATUS "pgo: building the optimised engine")
+build_engine("${USE_FLAGS}")
+run(${CMAKE_COMMAND} -E copy "${PGO_DIR}/ciorap-bot-03${CMAKE_EXECUTABLE_SUFFIX}" "${PGO_ENGINE}")
+
+bench_nps("${ENGINE}" regularNps)
+bench_nps("${PGO_ENGINE}" pgoNps)
+if(regularNps AND pgoNps)
+    # the uplift in tenths of a percent
+    math(EXPR uplift "(${pgoNps} - ${regularNps}) * 1000 / ${regularNps}")
+    set(sign "+")
+    if(uplift LESS 0)
+        set(sign "-")
+        math(EXPR uplift "-${uplift}")
+    endif()
+    math(EXPR upliftWhole "${uplift} / 10")
+    math(EXPR upliftTenth "${uplift} % 10")
+    message(STATUS "pgo: bench nps ${regularNps} -> ${pgoNps} (${sign}${upliftWhole}.${upliftTenth}%), engine at ${PGO_ENGINE}")
+endif()
@@ -1,8 +1,10 @@
 #include <unordered_map>
 #include <string>
-#include <stack>
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
 
 #include "Board.h"
 #include "MagicBitboardUtils.h"
@@ -10,123 +12,52 @@
 #include "Search.h"
 #include "MoveUtils.h"
 #include "BoardUtils.h"
+#include "NNUE.h"
+#include "Material.h"
 #include "Enums.h"
+#include "Profiler.h"
+#include "Cpu.h"
 
 using namespace std;
 
-Board::Board() : repetitionIndex(0), repetitionMap(new U64[1024]) {
+Board::Board() : stateStk(new StateInfo[STATE_STACK_SIZE]), accumulatorStk(new NNUE::Accumulator[NNUE::STACK_SIZE]) {
+#if COPY_MAKE
+    positionStk = new Position[STATE_STACK_SIZE];
+#endif
     clear();
 }
 
+Board::Board(const Board &other) : Position(other), stateStk(new StateInfo[STATE_STACK_SIZE]), accumulatorStk(new NNUE::Accumulator[NNUE::STACK_SIZE]),
+    stateIndex(other.stateIndex), accumulatorIndex(other.accumulatorIndex) {
+#if COPY_MAKE
+    positionStk = new Position[STATE_STACK_SIZE];
+    copy(other.positionStk, other.positionStk + stateIndex, positionStk);
+#endif
+    copy(other.stateStk, other.stateStk + stateIndex, stateStk);
+    accumulatorStk[accumulatorIndex] = other.accumulatorStk[accumulatorIndex];
+}
+
 Board::~Board() {
-    delete[] repetitionMap;
+#if COPY_MAKE
+    delete[] positionStk;
+#endif
+    delete[] stateStk;
+    delete[] accumulatorStk;
 }
 
 
 // initialize all the variables before starting the actual engine
 void init() {
-    // bitmasks for every bit from 0 to 63
-    for(int i = 0; i < 64; i++)
-        BoardUtils::bits[i] = (1LL << i);
+    // the attack and mask tables are generated at compile time and the kpk bitbase is built on its first probe
 
     // initialize zobrist numbers in order to make zobrist hash keys
     TranspositionTable::generateZobristHashNumbers();
 
-    // bitboard for checking empty squares between king and rook when castling
-    BoardUtils::castleMask[0] =(BoardUtils::bits[f1] | BoardUtils::bits[g1]);
-    BoardUtils::castleMask[1] = (BoardUtils::bits[b1] | BoardUtils::bits[c1] | BoardUtils::bits[d1]);
-    BoardUtils::castleMask[2] = (BoardUtils::bits[f8] | BoardUtils::bits[g8]);
-    BoardUtils::castleMask[3] = (BoardUtils::bits[b8] | BoardUtils::bits[c8] | BoardUtils::bits[d8]);
-
-    // create file and rank masks
-    for(int i = 0; i < 64; i++) {
-        int file = (i & 7), rank = (i >> 3);
-
-        BoardUtils::filesBB[file] |= BoardUtils::bits[i];
-        BoardUtils::ranksBB[rank] |= BoardUtils::bits[i];
-    }
-
-    // create pawn attacks masks and vectors
-    for(int i = 0; i < 64; i++) {
-        int file = (i & 7);
-
-        if(file > 0) {
-            if(i+7 < 64) BoardUtils::whitePawnAttacksBB[i] |= BoardUtils::bits[i+7];
-            if(i-9 >= 0) BoardUtils::blackPawnAttacksBB[i] |= BoardUtils::bits[i-9];
-        }
-        if(file < 7) {
-            if(i+9 < 64) BoardUtils::whitePawnAttacksBB[i] |= BoardUtils::bits[i+9];
-            if(i-7 >= 0) BoardUtils::blackPawnAttacksBB[i] |= BoardUtils::bits[i-7];
-        }
-    }
-
-    // create knight attacks masks and vectors
-    for(int i = 0; i < 64; i++) {
-        int file = (i & 7), rank = (i >> 3);
-
-        if(file > 1) {
-            if(rank > 0) BoardUtils::knightAttacksBB[i] |= BoardUtils::bits[i-10];
-            if(rank < 7) BoardUtils::knightAttacksBB[i] |= BoardUtils::bits[i+6];
-        }
-        if(file < 6) {
-            if(rank > 0) BoardUtils::knightAttacksBB[i] |= BoardUtils::bits[i-6];
-            if(rank < 7) BoardUtils::knightAttacksBB[i] |= BoardUtils::bits[i+10];
-        }
-        if(rank > 1) {
-            if(file > 0) BoardUtils::knightAttacksBB[i] |= BoardUtils::bits[i-17];
-            if(file < 7) BoardUtils::knightAttacksBB[i] |= BoardUtils::bits[i-15];
-        }
-        if(rank < 6) {
-            if(file > 0) BoardUtils::knightAttacksBB[i] |= BoardUtils::bits[i+15];
-            if(file < 7) BoardUtils::knightAttacksBB[i] |= BoardUtils::bits[i+17];
-        }
-    }
-
-    // create bishop masks
-    for(int i = 0; i < 64; i++) {
-        for(Direction dir: {northEast, northWest, southEast, southWest}) {
-            int sq = i;
-            while(BoardUtils::isInBoard(sq, dir)) {
-                BoardUtils::bishopMasks[i] |= BoardUtils::bits[sq];
-                sq += dir;
-            }
-        }
-        BoardUtils::bishopMasks[i] ^= BoardUtils::bits[i];
-    }
+    // pext indexing if the cpu has a fast implementation, magics otherwise
+    MagicBitboardUtils::setBackend(MagicBitboardUtils::cpuHasFastPext());
 
-    // create rook masks
-    for(int i = 0; i < 64; i++) {
-        for(Direction dir: {east, west, north, south}) {
-            int sq = i;
-            while(BoardUtils::isInBoard(sq, dir)) {
-                BoardUtils::rookMasks[i] |= BoardUtils::bits[sq];
-                sq += dir;
-            }
-        }
-        BoardUtils::rookMasks[i] ^= BoardUtils::bits[i];
-    }
-
-    // create king moves masks and vectors
-    for(int i = 0; i < 64; i++) {
-        BoardUtils::kingAttacksBB[i] = (BoardUtils::eastOne(BoardUtils::bits[i]) | BoardUtils::westOne(BoardUtils::bits[i]));
-        U64 king = (BoardUtils::bits[i] | BoardUtils::kingAttacksBB[i]);
-        BoardUtils::kingAttacksBB[i] |= (BoardUtils::northOne(king) | BoardUtils::southOne(king));
-    }
-
-    // squares near king are squares that a king can move to and the squares in front of his 'forward' moves
-    for(int i = 0; i < 64; i++) {
-        BoardUtils::squaresNearWhiteKing[i] = BoardUtils::squaresNearBlackKing[i] = (BoardUtils::kingAttacksBB[i] | BoardUtils::bits[i]);
-        if(i+south >= 0) BoardUtils::squaresNearBlackKing[i] |= BoardUtils::kingAttacksBB[i+south];
-        if(i+north < 64) BoardUtils::squaresNearWhiteKing[i] |= BoardUtils::kingAttacksBB[i+north];
-    }
-
-    // create light and dark squares masks
-    for(int i = 0; i < 64; i++) {
-        if(i%2) BoardUtils::lightSquaresBB |= BoardUtils::bits[i];
-        else BoardUtils::darkSquaresBB |= BoardUtils::bits[i];
-    }
-
-    MagicBitboardUtils::initMagics();
+    // the reversible moves for finding upcoming repetitions (after the backend, the slider attacks are needed)
+    TranspositionTable::generateCuckooTables();
 
     Search::clearHistory();
 }
@@ -134,38 +65,43 @@ void init() {
 void Board::clear() {
     for(int i = 0; i < 64; i++) this->squares[i] = Empty;
     whiteKingSquare = blackKingSquare = 0;
-    repetitionIndex = 0;
+    stateIndex = 0;
+    accumulatorIndex = 0;
 
     this->turn = White;
     this->castleRights = 0;
     this->ep = -1;
-    this->hashKey = 0;
+    this->hashKey = this->pawnKey = 0;
+    this->checkersBB = 0;
+    this->halfmoveClock = 0;
 
-    // clear bitboards
-    this->whitePiecesBB = this->blackPiecesBB = 0;
-    this->pawnsBB = this->knightsBB = this->bishopsBB = this->rooksBB = this->queensBB = 0;
+    // clear material
+    for(int i = 0; i < 16; i++) this->pieceCount[i] = 0;
+    this->materialKey = 0;
 
-    // clear stacks
-    while(!castleStk.empty()) castleStk.pop();
-    while(!epStk.empty()) epStk.pop();
-    while(!moveStk.empty()) moveStk.pop();
+    // clear bitboards
+    for(int i = 0; i < 7; i++) this->byType[i] = 0;
+    this->byColor[0] = this->byColor[1] = 0;
 }
 
 // updates the bitboards when a piece is moved
-void Board::updatePieceInBB(int piece, int color, int sq) {
-    if(color == White) this->whitePiecesBB ^= BoardUtils::bits[sq];
-    else this->blackPiecesBB ^= BoardUtils::bits[sq];
-
-    if(piece == Pawn) this->pawnsBB ^= BoardUtils::bits[sq];
-    if(piece == Knight) this->knightsBB ^= BoardUtils::bits[sq];
-    if(piece == Bishop) this->bishopsBB ^= BoardUtils::bits[sq];
-    if(piece == Rook) this->rooksBB ^= BoardUtils::bits[sq];
-    if(piece == Queen) this->queensBB ^= BoardUtils::bits[sq];
+template<Color C> HOT_INLINE inline void Board::updatePieceInBB(int piece, int sq) {
+    this->byColor[(int)(C == White)] ^= BoardUtils::bits[sq];
+    this->byType[piece] ^= BoardUtils::bits[sq];
+}
+
+// update the piece counts and the material key
+void Board::addMaterial(int piece, int color) {
+    this->materialKey ^= TranspositionTable::materialZobristNumbers[piece][(int)(color == White)][this->pieceCount[color | piece]++];
 }
 
-void Board::movePieceInBB(int piece, int color, int from, int to) {
-    this->updatePieceInBB(piece, color, from);
-    this->updatePieceInBB(piece, color, to);
+void Board::removeMaterial(int piece, int color) {
+    this->materialKey ^= TranspositionTable::materialZobristNumbers[piece][(int)(color == White)][--this->pieceCount[color | piece]];
+}
+
+template<Color C> HOT_INLINE inline void Board::movePieceInBB(int piece, int from, int to) {
+    this->updatePieceInBB<C>(piece, from);
+    this->updatePieceInBB<C>(piece, to);
 }
 
 string Board::getFenFromCurrPos() {
@@ -217,8 +153,8 @@ string Board::getFenFromCurrPos() {
     if(this->ep == -1) fen += '-';
     else fen += BoardUtils::square(this->ep);
 
-    //TODO: add halfmove clock and full moves
-    fen += " 0 1";
+    // halfmove clock, the full move number isn't kept so it is counted from the states on the stack
+    fen += ' ' + to_string(this->halfmoveClock) + ' ' + to_string(1 + this->stateIndex / 2);
 
     return fen;
 }
@@ -245,6 +181,12 @@ void Board::loadFenPos(string input) {
     string epTargetSq;
     for(; input[i] != ' ' && i < input.length(); i++) 
         epTargetSq += input[i];
+    i++;
+
+    // the halfmove clock is optional
+    string halfmoveClock;
+    for(; i < input.length() && isdigit(input[i]); i++)
+        halfmoveClock += input[i];
 
     unordered_map<char, int> pieceSymbols = {{'p', Pawn}, {'n', Knight},
     {'b', Bishop}, {'r', Rook}, {'q', Queen}, {'k', King}};
@@ -266,7 +208,10 @@ void Board::loadFenPos(string input) {
                 int color = ((p >= 'A' && p <= 'Z') ? White : Black);
                 int type = pieceSymbols[tolower(p)];
 
-                this->updatePieceInBB(type, color, rank*8 + file);
+                if(color == White) this->updatePieceInBB<White>(type, rank*8 + file);
+                else this->updatePieceInBB<Black>(type, rank*8 + file);
+                this->addMaterial(type, color);
+                if(type == Pawn) this->pawnKey ^= TranspositionTable::pieceZobristNumbers[Pawn][(int)(color == White)][rank*8 + file];
                 if(type == King) {
                     if(color == White) this->whiteKingSquare = rank*8 + file;
                     if(color == Black) this->blackKingSquare = rank*8 + file;
@@ -292,308 +237,57 @@ void Board::loadFenPos(string input) {
     // get en passant target square
     this->ep = (epTargetSq == "-" ? -1 : (epTargetSq[0]-'a' + 8*(epTargetSq[1]-'1')));
 
+    // get the plies since the last capture or pawn move
+    this->halfmoveClock = (halfmoveClock.empty() ? 0 : stoi(halfmoveClock));
+
     // initialize hash key
     this->hashKey = getZobristHashFromCurrPos();
-}
-
-// pseudo legal moves are moves that can be made but might leave the king in check
-short Board::generatePseudoLegalMoves() {
-    short numberOfMoves = 0;
-
-    int color = this->turn;
-
-    U64 ourPiecesBB = (color == White ? this->whitePiecesBB : this->blackPiecesBB);
-    U64 opponentPiecesBB = (color == White ? this->blackPiecesBB : this->whitePiecesBB);
-    U64 allPiecesBB = (this->whitePiecesBB | this->blackPiecesBB);
-
-    // -----pawns-----
-    U64 ourPawnsBB = (ourPiecesBB & this->pawnsBB);
-    int pawnDir = (color == White ? north : south);
-    int pawnStartRank = (color == White ? 1 : 6);
-    int pawnPromRank = (color == White ? 7 : 0);
-
-    while(ourPawnsBB) {
-        int sq = MagicBitboardUtils::bitscanForward(ourPawnsBB);
-        bool isPromoting = (((sq+pawnDir) >> 3) == pawnPromRank);
-
-        // normal moves and promotions
-        if((allPiecesBB & BoardUtils::bits[sq+pawnDir]) == 0) {
-            assert(this->squares[sq] == (Pawn | color));
-
-            if((sq >> 3) == pawnStartRank && (allPiecesBB & BoardUtils::bits[sq+2*pawnDir]) == 0)
-                pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, sq+2*pawnDir, color, Pawn, 0, 0, 0, 0);
-
-            if(isPromoting) {
-                for(int piece: {Knight, Bishop, Rook, Queen})
-                    pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, sq+pawnDir, color, Pawn, 0, piece, 0, 0);
-            } else pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, sq+pawnDir, color, Pawn, 0, 0, 0, 0);
-
-        }
-
-        // captures and capture-promotions
-        U64 pawnCapturesBB = (color == White ? BoardUtils::whitePawnAttacksBB[sq] : BoardUtils::blackPawnAttacksBB[sq]);
-        pawnCapturesBB &= opponentPiecesBB;
-        while(pawnCapturesBB) {
-            assert(this->squares[sq] == (Pawn | color));
-
-            int to = MagicBitboardUtils::bitscanForward(pawnCapturesBB);
-            if(isPromoting) {
-                for(int piece: {Knight, Bishop, Rook, Queen})
-                    pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, to, color, Pawn, (this->squares[to] & (~8)), piece, 0, 0);
-            } else pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, to, color, Pawn, (this->squares[to] & (~8)), 0, 0, 0);
-
-            pawnCapturesBB &= (pawnCapturesBB-1);
-
-        }
-
-        ourPawnsBB &= (ourPawnsBB-1);
-    }
-
-    //-----knights-----
-    U64 ourKnightsBB = (this->knightsBB & ourPiecesBB);
-
-    while(ourKnightsBB) {
-        int sq = MagicBitboardUtils::bitscanForward(ourKnightsBB);
-
-        U64 knightMoves = (BoardUtils::knightAttacksBB[sq] & ~ourPiecesBB);
-        while(knightMoves) {
-            assert(this->squares[sq] == (Knight | color));
-
-            int to = MagicBitboardUtils::bitscanForward(knightMoves);
-            pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, to, color, Knight, (this->squares[to] & (~8)), 0, 0, 0);
-            knightMoves &= (knightMoves-1);
-        }
 
-        ourKnightsBB &= (ourKnightsBB-1);
-    }
-
-    //-----king-----
-    int kingSquare = (color == White ? this->whiteKingSquare : this->blackKingSquare);
-    U64 ourKingMoves = (BoardUtils::kingAttacksBB[kingSquare] & ~ourPiecesBB);
-
-    while(ourKingMoves) {
-        assert(this->squares[kingSquare] == (King | color));
-
-        int to = MagicBitboardUtils::bitscanForward(ourKingMoves);
-        pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(kingSquare, to, color, King, (this->squares[to] & (~8)), 0, 0, 0);
-        ourKingMoves &= (ourKingMoves-1);
-    }
-
-    //-----sliding pieces-----
-    U64 rooksQueens = (ourPiecesBB & (this->rooksBB | this->queensBB));
-    while(rooksQueens) {
-        int sq = MagicBitboardUtils::bitscanForward(rooksQueens);
-
-        U64 rookMoves = (MagicBitboardUtils::magicRookAttacks(allPiecesBB, sq) & ~ourPiecesBB);
-        while(rookMoves) {
-            assert(this->squares[sq] == (Rook | color) || this->squares[sq] == (Queen | color));
-
-            int to = MagicBitboardUtils::bitscanForward(rookMoves);
-            pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, to, color, (this->squares[sq] & (~8)), (this->squares[to] & (~8)), 0, 0, 0);
-            rookMoves &= (rookMoves-1);
-        }
-
-        rooksQueens &= (rooksQueens-1);
-    }
-
-    U64 bishopsQueens = (ourPiecesBB & (this->bishopsBB | this->queensBB));
-    while(bishopsQueens) {
-        int sq = MagicBitboardUtils::bitscanForward(bishopsQueens);
-
-        U64 bishopMoves = (MagicBitboardUtils::magicBishopAttacks(allPiecesBB, sq) & ~ourPiecesBB);
-        while(bishopMoves) {
-             assert(this->squares[sq] == (Bishop | color) || this->squares[sq] == (Queen | color));
-
-            int to = MagicBitboardUtils::bitscanForward(bishopMoves);
-            pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, to, color, (this->squares[sq] & (~8)), (this->squares[to] & (~8)), 0, 0, 0);
-            bishopMoves &= (bishopMoves-1);
-        }
-
-        bishopsQueens &= (bishopsQueens-1);
-    }
+    int kingSquare = (this->turn == White ? this->whiteKingSquare : this->blackKingSquare);
+    this->checkersBB = (this->attackersTo(kingSquare, this->occupiedBB()) & this->piecesBB(this->turn ^ 8));
 
-    // -----castles-----
-    int allowedCastles = (color == White ? 3 : 12);
-    for(int i = 0; i < 4; i++) {
-        if((this->castleRights & BoardUtils::bits[i]) && ((allPiecesBB & BoardUtils::castleMask[i]) == 0) && (allowedCastles & BoardUtils::bits[i])) {
-            assert(this->squares[BoardUtils::castleStartSq[i]] == (King | color));
-
-            pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(BoardUtils::castleStartSq[i], BoardUtils::castleEndSq[i], color, King, 0, 0, 1, 0);
-        }
-    }
-
-
-    // -----en passant-----
-    if(ep != -1) {
-        ourPawnsBB = (this->pawnsBB & ourPiecesBB);
-        U64 epBB = ((color == White ? BoardUtils::blackPawnAttacksBB[ep] : BoardUtils::whitePawnAttacksBB[ep]) & ourPawnsBB);
-        while(epBB) {
-            int sq = MagicBitboardUtils::bitscanForward(epBB);
-
-            assert(this->squares[sq] == (Pawn | color));
-
-            pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, ep, color, Pawn, Pawn, 0, 0, 1);
-            epBB &= (epBB-1);
-        }
-    }
-    return numberOfMoves;
+    // initialize the nnue accumulator
+    if(NNUE::isActive()) this->refreshAccumulator();
 }
 
-short Board::generatePseudoLegalMovesQS() {
-    short numberOfMoves = 0;
-
-    int color = this->turn;
-
-    U64 ourPiecesBB = (color == White ? this->whitePiecesBB : this->blackPiecesBB);
-    U64 opponentPiecesBB = (color == White ? this->blackPiecesBB : this->whitePiecesBB);
-    U64 allPiecesBB = (this->whitePiecesBB | this->blackPiecesBB);
-
-    // -----pawns-----
-    U64 ourPawnsBB = (ourPiecesBB & this->pawnsBB);
-    int pawnDir = (color == White ? north : south);
-    int pawnPromRank = (color == White ? 7 : 0);
-
-    while(ourPawnsBB) {
-        int sq = MagicBitboardUtils::bitscanForward(ourPawnsBB);
-        bool isPromoting = (((sq+pawnDir) >> 3) == pawnPromRank);
-
-        // normal promotions
-        if((allPiecesBB & BoardUtils::bits[sq+pawnDir]) == 0) {
-            assert(this->squares[sq] == (Pawn | color));
-
-            if(isPromoting) {
-                for(int piece: {Knight, Bishop, Rook, Queen})
-                    pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, sq+pawnDir, color, Pawn, 0, piece, 0, 0);
-            }
-
-        }
-
-        // captures and capture-promotions
-        U64 pawnCapturesBB = (color == White ? BoardUtils::whitePawnAttacksBB[sq] : BoardUtils::blackPawnAttacksBB[sq]);
-        pawnCapturesBB &= opponentPiecesBB;
-        while(pawnCapturesBB) {
-            assert(this->squares[sq] == (Pawn | color));
-
-            int to = MagicBitboardUtils::bitscanForward(pawnCapturesBB);
-            if(isPromoting) {
-                for(int piece: {Knight, Bishop, Rook, Queen})
-                    pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, to, color, Pawn, (this->squares[to] & (~8)), piece, 0, 0);
-            } else pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, to, color, Pawn, (this->squares[to] & (~8)), 0, 0, 0);
-
-            pawnCapturesBB &= (pawnCapturesBB-1);
-
-        }
-
-        ourPawnsBB &= (ourPawnsBB-1);
-    }
-
-    //-----knights-----
-    U64 ourKnightsBB = (this->knightsBB & ourPiecesBB);
-
-    while(ourKnightsBB) {
-        int sq = MagicBitboardUtils::bitscanForward(ourKnightsBB);
-
-        U64 knightMoves = (BoardUtils::knightAttacksBB[sq] & opponentPiecesBB);
-        while(knightMoves) {
-            assert(this->squares[sq] == (Knight | color));
-
-            int to = MagicBitboardUtils::bitscanForward(knightMoves);
-            pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, to, color, Knight, (this->squares[to] & (~8)), 0, 0, 0);
-            knightMoves &= (knightMoves-1);
-        }
-
-        ourKnightsBB &= (ourKnightsBB-1);
-    }
-
-    //-----king-----
-    int kingSquare = (color == White ? this->whiteKingSquare : this->blackKingSquare);
-    U64 ourKingMoves = (BoardUtils::kingAttacksBB[kingSquare] & opponentPiecesBB);
-
-    while(ourKingMoves) {
-        assert(this->squares[kingSquare] == (King | color));
-
-        int to = MagicBitboardUtils::bitscanForward(ourKingMoves);
-        pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(kingSquare, to, color, King, (this->squares[to] & (~8)), 0, 0, 0);
-        ourKingMoves &= (ourKingMoves-1);
-    }
-
-    //-----sliding pieces-----
-    U64 rooksQueens = (ourPiecesBB & (this->rooksBB | this->queensBB));
-    while(rooksQueens) {
-        int sq = MagicBitboardUtils::bitscanForward(rooksQueens);
-
-        U64 rookMoves = (MagicBitboardUtils::magicRookAttacks(allPiecesBB, sq) & opponentPiecesBB);
-        while(rookMoves) {
-            assert(this->squares[sq] == (Rook | color) || this->squares[sq] == (Queen | color));
-
-            int to = MagicBitboardUtils::bitscanForward(rookMoves);
-            pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, to, color, (this->squares[sq] & (~8)), (this->squares[to] & (~8)), 0, 0, 0);
-            rookMoves &= (rookMoves-1);
-        }
-
-        rooksQueens &= (rooksQueens-1);
-    }
-
-    U64 bishopsQueens = (ourPiecesBB & (this->bishopsBB | this->queensBB));
-    while(bishopsQueens) {
-        int sq = MagicBitboardUtils::bitscanForward(bishopsQueens);
-
-        U64 bishopMoves = (MagicBitboardUtils::magicBishopAttacks(allPiecesBB, sq) & opponentPiecesBB);
-        while(bishopMoves) {
-             assert(this->squares[sq] == (Bishop | color) || this->squares[sq] == (Queen | color));
-
-            int to = MagicBitboardUtils::bitscanForward(bishopMoves);
-            pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, to, color, (this->squares[sq] & (~8)), (this->squares[to] & (~8)), 0, 0, 0);
-            bishopMoves &= (bishopMoves-1);
-        }
-
-        bishopsQueens &= (bishopsQueens-1);
-    }
-
-    // -----en passant-----
-    if(ep != -1) {
-        ourPawnsBB = (this->pawnsBB & ourPiecesBB);
-        U64 epBB = ((color == White ? BoardUtils::blackPawnAttacksBB[ep] : BoardUtils::whitePawnAttacksBB[ep]) & ourPawnsBB);
-        while(epBB) {
-            int sq = MagicBitboardUtils::bitscanForward(epBB);
-
-            assert(this->squares[sq] == (Pawn | color));
-
-            pseudoLegalMoves[numberOfMoves++] = MoveUtils::getMove(sq, ep, color, Pawn, Pawn, 0, 0, 1);
-            epBB &= (epBB-1);
-        }
-    }
-    return numberOfMoves;
+// compute the nnue accumulator of the current position from scratch
+void Board::refreshAccumulator() {
+    NNUE::refresh(this, accumulatorStk[accumulatorIndex], White);
+    NNUE::refresh(this, accumulatorStk[accumulatorIndex], Black);
 }
 
 // returns true if the square sq is attacked by enemy pieces
-bool Board::isAttacked(int sq) {
-    int color = this->turn;
-    int otherColor = (color ^ (Black | White));
-    int otherKingSquare = (otherColor == White ? this->whiteKingSquare : this->blackKingSquare);
+HOT_KERNEL bool Board::isAttacked(int sq) {
+    U64 allPiecesBB = this->occupiedBB();
+    return (this->turn == White ? this->isAttacked<White>(sq, allPiecesBB) : this->isAttacked<Black>(sq, allPiecesBB));
+}
 
-    U64 opponentPiecesBB = (color == White ? this->blackPiecesBB : this->whitePiecesBB);
-    U64 allPiecesBB = (this->whitePiecesBB | this->blackPiecesBB);
-    U64 bishopsQueens = (opponentPiecesBB & (this->bishopsBB | this->queensBB));
-    U64 rooksQueens = (opponentPiecesBB & (this->rooksBB | this->queensBB));
+// same as above, but the sliding attacks are computed with the given occupancy
+template<Color Us> HOT_INLINE inline bool Board::isAttacked(int sq, U64 allPiecesBB) {
+    int otherKingSquare = (Us == White ? this->blackKingSquare : this->whiteKingSquare);
+
+    U64 opponentPiecesBB = this->piecesBB(Us ^ 8);
+    U64 bishopsQueens = (opponentPiecesBB & (this->byType[Bishop] | this->byType[Queen]));
+    U64 rooksQueens = (opponentPiecesBB & (this->byType[Rook] | this->byType[Queen]));
 
     // king attacks
     if(BoardUtils::kingAttacksBB[otherKingSquare] & BoardUtils::bits[sq])
         return true;
 
     // knight attacks
-    if(BoardUtils::knightAttacksBB[sq] & opponentPiecesBB & this->knightsBB)
+    if(BoardUtils::knightAttacksBB[sq] & opponentPiecesBB & this->byType[Knight])
         return true;
 
-    // pawn attacks
-    if(BoardUtils::bits[sq] & BoardUtils::pawnAttacks((opponentPiecesBB & this->pawnsBB), otherColor))
+    // pawn attacks (the enemy pawns that attack sq are on the squares our pawn would attack from sq)
+    U64 pawnAtt = (Us == White ? BoardUtils::whitePawnAttacksBB[sq] : BoardUtils::blackPawnAttacksBB[sq]);
+    if(pawnAtt & opponentPiecesBB & this->byType[Pawn])
         return true;
 
     // sliding piece attacks
-    if(bishopsQueens & MagicBitboardUtils::magicBishopAttacks(allPiecesBB, sq))
+    if(bishopsQueens && (bishopsQueens & MagicBitboardUtils::magicBishopAttacks(allPiecesBB, sq)))
         return true;
 
-    if(rooksQueens & MagicBitboardUtils::magicRookAttacks(allPiecesBB, sq))
+    if(rooksQueens && (rooksQueens & MagicBitboardUtils::magicRookAttacks(allPiecesBB, sq)))
         return true;
 
     return false;
@@ -601,25 +295,23 @@ bool Board::isAttacked(int sq) {
 
 // returns true if the current player is in check
 bool Board::isInCheck() {
-    int color = this->turn;
-    int kingSquare = (color == White ? this->whiteKingSquare : this->blackKingSquare);
-    return this->isAttacked(kingSquare);
+    return (this->checkersBB != 0);
 }
 
 // returns the bitboard that contains all the attackers on the square sq
-U64 Board::attacksTo(int sq) {
+HOT_KERNEL U64 Board::attacksTo(int sq) {
     int color = (this->turn ^ (Black | White));
 
-    U64 ourPiecesBB = (color == White ? this->whitePiecesBB : this->blackPiecesBB);
-    U64 allPiecesBB = (this->whitePiecesBB | this->blackPiecesBB);
+    U64 ourPiecesBB = this->piecesBB(color);
+    U64 allPiecesBB = this->occupiedBB();
     U64 pawnAtt = (color == Black ? BoardUtils::whitePawnAttacksBB[sq] : BoardUtils::blackPawnAttacksBB[sq]);
-    U64 rooksQueens = (ourPiecesBB & (this->rooksBB | this->queensBB));
-    U64 bishopsQueens = (ourPiecesBB & (this->bishopsBB | this->queensBB));
+    U64 rooksQueens = (ourPiecesBB & (this->byType[Rook] | this->byType[Queen]));
+    U64 bishopsQueens = (ourPiecesBB & (this->byType[Bishop] | this->byType[Queen]));
     int kingSquare = (color == White ? this->whiteKingSquare : this->blackKingSquare);
 
     U64 res = 0;
-    res |= (BoardUtils::knightAttacksBB[sq] & ourPiecesBB & this->knightsBB);
-    res |= (pawnAtt & this->pawnsBB & ourPiecesBB);
+    res |= (BoardUtils::knightAttacksBB[sq] & ourPiecesBB & this->byType[Knight]);
+    res |= (pawnAtt & this->byType[Pawn] & ourPiecesBB);
     res |= (BoardUtils::kingAttacksBB[sq] & BoardUtils::bits[kingSquare]);
     res |= (MagicBitboardUtils::magicBishopAttacks(allPiecesBB, sq) & bishopsQueens);
     res |= (MagicBitboardUtils::magicRookAttacks(allPiecesBB, sq) & rooksQueens);
@@ -627,352 +319,497 @@ U64 Board::attacksTo(int sq) {
     return res;
 }
 
-// takes the pseudo legal moves and checks if they don't leave the king in check
-int Board::generateLegalMoves(int *moves) {
-    int color = this->turn;
-    int kingSquare = (color == White ? this->whiteKingSquare : this->blackKingSquare);
+// all the pieces (of both colors) that attack the square sq, given the occupancy of the board
+HOT_KERNEL U64 Board::attackersTo(int sq, U64 occ) {
+    return (BoardUtils::whitePawnAttacksBB[sq] & this->byType[Pawn] & this->piecesBB(Black))
+         | (BoardUtils::blackPawnAttacksBB[sq] & this->byType[Pawn] & this->piecesBB(White))
+         | (BoardUtils::knightAttacksBB[sq] & this->byType[Knight])
+         | (BoardUtils::kingAttacksBB[sq] & this->byType[King])
+         | (MagicBitboardUtils::magicBishopAttacks(occ, sq) & (this->byType[Bishop] | this->byType[Queen]))
+         | (MagicBitboardUtils::magicRookAttacks(occ, sq) & (this->byType[Rook] | this->byType[Queen]));
+}
 
-    U64 allPiecesBB = (this->whitePiecesBB | this->blackPiecesBB);
-    U64 opponentPiecesBB = (color == White ? this->blackPiecesBB : this->whitePiecesBB);
-    U64 ourPiecesBB = (color == White ? this->whitePiecesBB : this->blackPiecesBB);
+// our pieces that are the only blocker between our king and an enemy slider
+HOT_KERNEL U64 Board::pinnedPieces(int kingSquare, U64 ourPiecesBB, U64 opponentPiecesBB) {
+    U64 allPiecesBB = (ourPiecesBB | opponentPiecesBB);
 
-    short pseudoNum = this->generatePseudoLegalMoves();
-    unsigned int num = 0;
+    // enemy sliders that would attack the king on an empty board
+    U64 snipers = (((MagicBitboardUtils::magicRookAttacks(0, kingSquare) & (this->byType[Rook] | this->byType[Queen]))
+                  | (MagicBitboardUtils::magicBishopAttacks(0, kingSquare) & (this->byType[Bishop] | this->byType[Queen]))) & opponentPiecesBB);
 
-    // remove the king so we can correctly find all squares attacked by sliding pieces, where the king can't go
-    if(color == White) this->whitePiecesBB ^= BoardUtils::bits[kingSquare];
-    else this->blackPiecesBB ^= BoardUtils::bits[kingSquare];
+    U64 pinnedBB = 0;
+    while(snipers) {
+        int sq = MagicBitboardUtils::bitscanForward(snipers);
 
-    U64 checkingPiecesBB = this->attacksTo(kingSquare);
-    int checkingPiecesCnt = MagicBitboardUtils::popcount(checkingPiecesBB);
-    int checkingPieceIndex = MagicBitboardUtils::bitscanForward(checkingPiecesBB);
+        U64 blockers = (BoardUtils::betweenBB[kingSquare][sq] & allPiecesBB);
+        if(blockers && (blockers & (blockers-1)) == 0) pinnedBB |= (blockers & ourPiecesBB);
 
-    // check ray is the path between the king and the sliding piece checking it
-    U64 checkRayBB = 0;
-    if(checkingPiecesCnt == 1) {
-        checkRayBB |= checkingPiecesBB;
-        int dir = BoardUtils::direction(checkingPieceIndex, kingSquare);
+        snipers &= (snipers-1);
+    }
 
-        // check direction is a straight line
-        if(abs(dir) == north || abs(dir) == east)
-            checkRayBB |= (MagicBitboardUtils::magicRookAttacks(allPiecesBB, kingSquare) & MagicBitboardUtils::magicRookAttacks(allPiecesBB, checkingPieceIndex));
+    return pinnedBB;
+}
 
-        // check direction is a diagonal
-        else checkRayBB |= (MagicBitboardUtils::magicBishopAttacks(allPiecesBB, kingSquare) & MagicBitboardUtils::magicBishopAttacks(allPiecesBB, checkingPieceIndex));
-    }
+// the squares from which our pieces would check the enemy king and the pieces that would uncover a check by moving
+void Board::checkInfo(CheckInfo &ci) {
+    int kingSquare = (this->turn == White ? this->blackKingSquare : this->whiteKingSquare);
+    U64 ourPiecesBB = this->piecesBB(this->turn);
+    U64 allPiecesBB = this->occupiedBB();
 
-    // finding the absolute pins
-    U64 pinnedBB = 0;
+    ci.kingSquare = kingSquare;
 
-    U64 attacks = MagicBitboardUtils::magicRookAttacks(allPiecesBB, kingSquare); // attacks on the rook directions from the king square to our pieces
-    U64 blockers = (ourPiecesBB & attacks); // potentially pinned pieces
-    U64 oppRooksQueens = ((this->rooksBB | this->queensBB) & opponentPiecesBB);
-    U64 pinners = ((attacks ^ MagicBitboardUtils::magicRookAttacks((allPiecesBB ^ blockers), kingSquare)) & oppRooksQueens); // get pinners by computing attacks on the board without the blockers
-    while(pinners) {
-        int sq = MagicBitboardUtils::bitscanForward(pinners);
+    // our pawns attack the king from the squares that the king would attack as a pawn of our color
+    ci.checkSquaresBB[Empty] = ci.checkSquaresBB[King] = 0;
+    ci.checkSquaresBB[Pawn] = (this->turn == White ? BoardUtils::blackPawnAttacksBB[kingSquare] : BoardUtils::whitePawnAttacksBB[kingSquare]);
+    ci.checkSquaresBB[Knight] = BoardUtils::knightAttacksBB[kingSquare];
+    ci.checkSquaresBB[Bishop] = MagicBitboardUtils::magicBishopAttacks(allPiecesBB, kingSquare);
+    ci.checkSquaresBB[Rook] = MagicBitboardUtils::magicRookAttacks(allPiecesBB, kingSquare);
+    ci.checkSquaresBB[Queen] = (ci.checkSquaresBB[Bishop] | ci.checkSquaresBB[Rook]);
 
-        // get pinned pieces by &-ing attacks from the rook square with attacks from the king square, and then with our own pieces
-        pinnedBB |= (MagicBitboardUtils::magicRookAttacks(allPiecesBB, sq) & MagicBitboardUtils::magicRookAttacks(allPiecesBB, kingSquare) & ourPiecesBB);
-        pinners &= (pinners-1); // remove bit
-    }
+    // our sliders that would attack the king on an empty board, the same way as the pins in pinnedPieces
+    U64 snipers = (((MagicBitboardUtils::magicRookAttacks(0, kingSquare) & (this->byType[Rook] | this->byType[Queen]))
+                  | (MagicBitboardUtils::magicBishopAttacks(0, kingSquare) & (this->byType[Bishop] | this->byType[Queen]))) & ourPiecesBB);
 
-    attacks = MagicBitboardUtils::magicBishopAttacks(allPiecesBB, kingSquare);
-    blockers = (ourPiecesBB & attacks);
-    U64 oppBishopsQueens = ((this->bishopsBB | this->queensBB) & opponentPiecesBB);
-    pinners = ((attacks ^ MagicBitboardUtils::magicBishopAttacks((allPiecesBB ^ blockers), kingSquare)) & oppBishopsQueens);
-    while(pinners) {
-        int sq = MagicBitboardUtils::bitscanForward(pinners);
-        pinnedBB |= (MagicBitboardUtils::magicBishopAttacks(allPiecesBB, sq) & MagicBitboardUtils::magicBishopAttacks(allPiecesBB, kingSquare) & ourPiecesBB);
-        pinners &= (pinners-1);
-    }
+    ci.discoverersBB = 0;
+    while(snipers) {
+        int sq = MagicBitboardUtils::bitscanForward(snipers);
 
-    for(int idx = 0; idx < pseudoNum; idx++) {
-        int from = MoveUtils::getFromSq(pseudoLegalMoves[idx]);
-        int to = MoveUtils::getToSq(pseudoLegalMoves[idx]);
+        U64 blockers = (BoardUtils::betweenBB[kingSquare][sq] & allPiecesBB);
+        if(blockers && (blockers & (blockers-1)) == 0) ci.discoverersBB |= (blockers & ourPiecesBB);
 
-        // we can always move the king to a safe square
-        if(from == kingSquare) {
-            if(this->isAttacked(to) == false) moves[num++] = pseudoLegalMoves[idx];
-            continue;
-        }
+        snipers &= (snipers-1);
+    }
+}
+
+// returns true if the (legal) move checks the enemy king, without making it
+bool Board::givesCheck(Move move, const CheckInfo &ci) {
+    int from = MoveUtils::getFromSq(move);
+    int to = MoveUtils::getToSq(move);
+    int piece = this->movedPiece(move);
 
-        // single check, can capture the attacker or intercept the check only if the moving piece is not pinned
-        if(checkingPiecesCnt == 1 && ((pinnedBB & BoardUtils::bits[from]) == 0)) {
+    // direct check (promotions are checked below, with the promoted piece)
+    if(!MoveUtils::isPromotion(move) && (ci.checkSquaresBB[piece] & BoardUtils::bits[to])) return true;
 
-            // capturing the checking pawn by en passant (special case)
-            if(MoveUtils::isEP(pseudoLegalMoves[idx]) && checkingPieceIndex == to + (color == White ? south: north))
-                moves[num++] = pseudoLegalMoves[idx];
+    // discovered check, the piece leaves the line between one of our sliders and the king
+    if((ci.discoverersBB & BoardUtils::bits[from]) && !(BoardUtils::lineBB[from][ci.kingSquare] & BoardUtils::bits[to])) return true;
 
-            // check ray includes interception or capturing the attacker
-            else if(checkRayBB & BoardUtils::bits[to]) {
-                moves[num++] = pseudoLegalMoves[idx];
-            }
-        }
+    if(MoveUtils::getFlag(move) == MoveUtils::NORMAL) return false;
 
-        // no checks, every piece can move if it is not pinned or it moves in the direction of the pin
-        if(checkingPiecesCnt == 0) {
-            // not pinned
-            if((pinnedBB & BoardUtils::bits[from]) == 0)
-                moves[num++] = pseudoLegalMoves[idx];
+    // the special moves change more than the squares of the piece, so their attacks are computed with the new occupancy
+    U64 occ = ((this->occupiedBB() ^ BoardUtils::bits[from]) | BoardUtils::bits[to]);
+    U64 kingBB = BoardUtils::bits[ci.kingSquare];
 
-            // pinned, can only move in the pin direction
-            else if(abs(BoardUtils::direction(from, to)) == abs(BoardUtils::direction(from, kingSquare)))
-                moves[num++] = pseudoLegalMoves[idx];
+    if(MoveUtils::isPromotion(move)) {
+        switch(MoveUtils::getPromotionPiece(move)) {
+            case Knight: return (BoardUtils::knightAttacksBB[to] & kingBB);
+            case Bishop: return (MagicBitboardUtils::magicBishopAttacks(occ, to) & kingBB);
+            case Rook: return (MagicBitboardUtils::magicRookAttacks(occ, to) & kingBB);
+            default: return ((MagicBitboardUtils::magicBishopAttacks(occ, to) | MagicBitboardUtils::magicRookAttacks(occ, to)) & kingBB);
         }
     }
 
-    // en passant are the last added pseudo legal moves
-    int epMoves[2];
-    int numEp = 0;
-    while(num && MoveUtils::isEP(moves[num-1])) {
-        epMoves[numEp++] = moves[--num];
-    }
-
-    assert(numEp <= 2);
+    // the captured pawn can uncover a check too
+    if(MoveUtils::isEP(move)) {
+        occ ^= BoardUtils::bits[to + (this->turn == White ? south : north)];
 
-    // before ep there are the castle moves so we do the same
-    int castleMoves[2];
-    int numCastles = 0;
-    while(num && MoveUtils::isCastle(moves[num-1])) {
-        castleMoves[numCastles++] = moves[--num];
+        U64 ourPiecesBB = this->piecesBB(this->turn);
+        return ((MagicBitboardUtils::magicBishopAttacks(occ, ci.kingSquare) & (this->byType[Bishop] | this->byType[Queen]) & ourPiecesBB)
+              | (MagicBitboardUtils::magicRookAttacks(occ, ci.kingSquare) & (this->byType[Rook] | this->byType[Queen]) & ourPiecesBB));
     }
-    assert(numCastles <= 2);
 
-    // manual check for the legality of castle moves
-    for(int idx = 0; idx < numCastles; idx++) {
-        int from = MoveUtils::getFromSq(castleMoves[idx]);
-        int to = MoveUtils::getToSq(castleMoves[idx]);
+    // castling: only the rook can give check
+    int rank = (to >> 3), file = (to & 7);
+    int rookStartSquare = (rank << 3) + (file == 6 ? 7 : 0);
+    int rookEndSquare = (rank << 3) + (file == 6 ? 5 : 3);
+    occ = ((occ ^ BoardUtils::bits[rookStartSquare]) | BoardUtils::bits[rookEndSquare]);
 
-        int first = min(from, to);
-        int second = max(from, to);
+    return (MagicBitboardUtils::magicRookAttacks(occ, rookEndSquare) & kingBB);
+}
 
-        bool ok = true;
+// adds the pawn moves that land on the target squares, the pawns coming from (to - dir)
+// pinned pawns can only move along the line of the pin
+template<Color Us> HOT_INLINE inline int Board::addPawnMoves(Move *moves, int num, U64 targets, int dir, U64 pinnedBB, int kingSquare) {
+    const U64 promRankBB = BoardUtils::ranksBB[(Us == White ? 7 : 0)];
 
-        for(int i = first; i <= second; i++)
-            if(this->isAttacked(i))
-                ok = false;
+    while(targets) {
+        int to = MagicBitboardUtils::bitscanForward(targets);
+        int from = to-dir;
+        targets &= (targets-1);
 
-        if(ok) moves[num++] = castleMoves[idx];
-    }
+        if((pinnedBB & BoardUtils::bits[from]) && (BoardUtils::lineBB[kingSquare][from] & BoardUtils::bits[to]) == 0) continue;
 
-    // ep horizontal pin
-    for(int idx = 0; idx < numEp; idx++) {
-        int from = MoveUtils::getFromSq(epMoves[idx]);
-        int to = MoveUtils::getToSq(epMoves[idx]);
+        assert(this->squares[from] == (Pawn | (int)Us));
 
-        int epRank = (from >> 3);
-        int otherPawnSquare = (epRank << 3) | (to & 7);
-        U64 rooksQueens = (opponentPiecesBB & (this->rooksBB | this->queensBB) & BoardUtils::ranksBB[epRank]);
+        if(promRankBB & BoardUtils::bits[to]) {
+            for(int piece: {Knight, Bishop, Rook, Queen})
+                moves[num++] = MoveUtils::getMove(from, to, MoveUtils::PROMOTION, piece);
+        } else moves[num++] = MoveUtils::getMove(from, to);
+    }
 
-        // remove the 2 pawns and compute attacks from rooks/queens on king square
-        U64 removeWhite = BoardUtils::bits[from], 
-            removeBlack = BoardUtils::bits[otherPawnSquare];
-        if(color == Black) swap(removeWhite, removeBlack);
+    return num;
+}
 
-        this->whitePiecesBB ^= removeWhite;
-        this->blackPiecesBB ^= removeBlack;
+// adds the moves of a piece to the target squares
+template<Color Us> HOT_INLINE inline int Board::addPieceMoves(Move *moves, int num, int from, U64 targets) {
+    while(targets) {
+        int to = MagicBitboardUtils::bitscanForward(targets);
+        moves[num++] = MoveUtils::getMove(from, to);
+        targets &= (targets-1);
+    }
 
-        U64 attacks = this->attacksTo(kingSquare);
-        if((rooksQueens & attacks) == 0) moves[num++] = epMoves[idx];
+    return num;
+}
 
-        this->whitePiecesBB ^= removeWhite;
-        this->blackPiecesBB ^= removeBlack;
+// ---legal move generation---
+// checkers (cached when the previous move was made) and pinned pieces are computed once, and then every piece only generates moves that keep the king safe:
+// - in double check only the king can move
+// - in single check the other pieces can only capture the checker or block the check ray
+// - pinned pieces can only move on the line between the king and the pinner
+// if quiets is false, only captures and promotions are generated (used by the quiescence search)
+template<Color Us> HOT_INLINE inline int Board::generateMoves(Move *moves, bool quiets) {
+    // everything that depends on the side to move is known at compile time
+    const int kingSquare = (Us == White ? this->whiteKingSquare : this->blackKingSquare);
+
+    U64 ourPiecesBB = this->piecesBB(Us);
+    U64 opponentPiecesBB = this->piecesBB(Us ^ 8);
+    U64 allPiecesBB = this->occupiedBB();
+    U64 emptyBB = ~allPiecesBB;
+
+    U64 checkersBB = this->checkersBB;
+    int num = 0;
+
+    // -----king-----
+    // the king is removed from the board so that it can't step back along the ray of a slider checking it
+    U64 kingMoves = (BoardUtils::kingAttacksBB[kingSquare] & (quiets ? ~ourPiecesBB : opponentPiecesBB));
+    U64 occWithoutKing = (allPiecesBB ^ BoardUtils::bits[kingSquare]);
+    while(kingMoves) {
+        int to = MagicBitboardUtils::bitscanForward(kingMoves);
+        if(!this->isAttacked<Us>(to, occWithoutKing))
+            moves[num++] = MoveUtils::getMove(kingSquare, to);
+
+        kingMoves &= (kingMoves-1);
     }
 
-    // put the king back
-    if(color == White) this->whitePiecesBB ^= BoardUtils::bits[kingSquare];
-    else this->blackPiecesBB ^= BoardUtils::bits[kingSquare];
+    // double check, only the king can move
+    if(checkersBB & (checkersBB-1)) return num;
 
-    return num;
-}
+    // squares where the other pieces can move to, either capturing the checker or blocking the check
+    U64 checkMaskBB = ~0ULL;
+    if(checkersBB) checkMaskBB = (checkersBB | BoardUtils::betweenBB[kingSquare][MagicBitboardUtils::bitscanForward(checkersBB)]);
 
-int Board::generateLegalMovesQS(int *moves) {
-    int color = this->turn;
-    int kingSquare = (color == White ? this->whiteKingSquare : this->blackKingSquare);
+    U64 pinnedBB = this->pinnedPieces(kingSquare, ourPiecesBB, opponentPiecesBB);
 
-    U64 allPiecesBB = (this->whitePiecesBB | this->blackPiecesBB);
-    U64 opponentPiecesBB = (color == White ? this->blackPiecesBB : this->whitePiecesBB);
-    U64 ourPiecesBB = (color == White ? this->whitePiecesBB : this->blackPiecesBB);
+    U64 captureTargets = (opponentPiecesBB & checkMaskBB);
+    U64 quietTargets = (quiets ? (emptyBB & checkMaskBB) : 0);
 
-    short pseudoNum = this->generatePseudoLegalMovesQS();
-    unsigned int num = 0;
+    // -----pawns-----
+    // pushes and captures are generated for all the pawns at once, by shifting the pawn bitboard
+    U64 ourPawnsBB = (ourPiecesBB & this->byType[Pawn]);
+    constexpr int pawnDir = (Us == White ? north : south);
+    U64 promRankBB = BoardUtils::ranksBB[(Us == White ? 7 : 0)];
+    U64 doublePushRankBB = BoardUtils::ranksBB[(Us == White ? 3 : 4)];
 
-    // remove the king so we can correctly find all squares attacked by sliding pieces, where the king can't go
-    if(color == White) this->whitePiecesBB ^= BoardUtils::bits[kingSquare];
-    else this->blackPiecesBB ^= BoardUtils::bits[kingSquare];
+    U64 singlePushes = (Us == White ? BoardUtils::northOne(ourPawnsBB) : BoardUtils::southOne(ourPawnsBB)) & emptyBB;
+    U64 doublePushes = (Us == White ? BoardUtils::northOne(singlePushes) : BoardUtils::southOne(singlePushes)) & emptyBB & doublePushRankBB;
 
-    U64 checkingPiecesBB = this->attacksTo(kingSquare);
-    int checkingPiecesCnt = MagicBitboardUtils::popcount(checkingPiecesBB);
-    int checkingPieceIndex = MagicBitboardUtils::bitscanForward(checkingPiecesBB);
+    // without quiets, the only pushes are promotions
+    singlePushes &= (quiets ? checkMaskBB : (checkMaskBB & promRankBB));
+    doublePushes &= quietTargets;
 
-    // check ray is the path between the king and the sliding piece checking it
-    U64 checkRayBB = 0;
-    if(checkingPiecesCnt == 1) {
-        checkRayBB |= checkingPiecesBB;
-        int dir = BoardUtils::direction(checkingPieceIndex, kingSquare);
+    num = this->addPawnMoves<Us>(moves, num, singlePushes, pawnDir, pinnedBB, kingSquare);
+    num = this->addPawnMoves<Us>(moves, num, doublePushes, 2*pawnDir, pinnedBB, kingSquare);
 
-        // check direction is a straight line
-        if(abs(dir) == north || abs(dir) == east)
-            checkRayBB |= (MagicBitboardUtils::magicRookAttacks(allPiecesBB, kingSquare) & MagicBitboardUtils::magicRookAttacks(allPiecesBB, checkingPieceIndex));
+    U64 pawnsForward = (Us == White ? BoardUtils::northOne(ourPawnsBB) : BoardUtils::southOne(ourPawnsBB));
+    num = this->addPawnMoves<Us>(moves, num, BoardUtils::eastOne(pawnsForward) & captureTargets, pawnDir+east, pinnedBB, kingSquare);
+    num = this->addPawnMoves<Us>(moves, num, BoardUtils::westOne(pawnsForward) & captureTargets, pawnDir+west, pinnedBB, kingSquare);
 
-        // check direction is a diagonal
-        else checkRayBB |= (MagicBitboardUtils::magicBishopAttacks(allPiecesBB, kingSquare) & MagicBitboardUtils::magicBishopAttacks(allPiecesBB, checkingPieceIndex));
+    //-----knights-----
+    // pinned knights can never move
+    U64 ourKnightsBB = (this->byType[Knight] & ourPiecesBB & ~pinnedBB);
+    while(ourKnightsBB) {
+        int sq = MagicBitboardUtils::bitscanForward(ourKnightsBB);
+        num = this->addPieceMoves<Us>(moves, num, sq, BoardUtils::knightAttacksBB[sq] & (captureTargets | quietTargets));
+        ourKnightsBB &= (ourKnightsBB-1);
     }
 
-    // finding the absolute pins
-    U64 pinnedBB = 0;
+    //-----sliding pieces-----
+    U64 rooksQueens = (ourPiecesBB & (this->byType[Rook] | this->byType[Queen]));
+    while(rooksQueens) {
+        int sq = MagicBitboardUtils::bitscanForward(rooksQueens);
 
-    U64 attacks = MagicBitboardUtils::magicRookAttacks(allPiecesBB, kingSquare); // attacks on the rook directions from the king square to our pieces
-    U64 blockers = (ourPiecesBB & attacks); // potentially pinned pieces
-    U64 oppRooksQueens = ((this->rooksBB | this->queensBB) & opponentPiecesBB);
-    U64 pinners = ((attacks ^ MagicBitboardUtils::magicRookAttacks((allPiecesBB ^ blockers), kingSquare)) & oppRooksQueens); // get pinners by computing attacks on the board without the blockers
-    while(pinners) {
-        int sq = MagicBitboardUtils::bitscanForward(pinners);
+        U64 rookMoves = (MagicBitboardUtils::magicRookAttacks(allPiecesBB, sq) & (captureTargets | quietTargets));
+        if(pinnedBB & BoardUtils::bits[sq]) rookMoves &= BoardUtils::lineBB[kingSquare][sq];
 
-        // get pinned pieces by &-ing attacks from the rook square with attacks from the king square, and then with our own pieces
-        pinnedBB |= (MagicBitboardUtils::magicRookAttacks(allPiecesBB, sq) & MagicBitboardUtils::magicRookAttacks(allPiecesBB, kingSquare) & ourPiecesBB);
-        pinners &= (pinners-1); // remove bit
+        num = this->addPieceMoves<Us>(moves, num, sq, rookMoves);
+        rooksQueens &= (rooksQueens-1);
     }
 
-    attacks = MagicBitboardUtils::magicBishopAttacks(allPiecesBB, kingSquare);
-    blockers = (ourPiecesBB & attacks);
-    U64 oppBishopsQueens = ((this->bishopsBB | this->queensBB) & opponentPiecesBB);
-    pinners = ((attacks ^ MagicBitboardUtils::magicBishopAttacks((allPiecesBB ^ blockers), kingSquare)) & oppBishopsQueens);
-    while(pinners) {
-        int sq = MagicBitboardUtils::bitscanForward(pinners);
-        pinnedBB |= (MagicBitboardUtils::magicBishopAttacks(allPiecesBB, sq) & MagicBitboardUtils::magicBishopAttacks(allPiecesBB, kingSquare) & ourPiecesBB);
-        pinners &= (pinners-1);
-    }
+    U64 bishopsQueens = (ourPiecesBB & (this->byType[Bishop] | this->byType[Queen]));
+    while(bishopsQueens) {
+        int sq = MagicBitboardUtils::bitscanForward(bishopsQueens);
 
-    for(int idx = 0; idx < pseudoNum; idx++) {
-        int from = MoveUtils::getFromSq(pseudoLegalMoves[idx]);
-        int to = MoveUtils::getToSq(pseudoLegalMoves[idx]);
+        U64 bishopMoves = (MagicBitboardUtils::magicBishopAttacks(allPiecesBB, sq) & (captureTargets | quietTargets));
+        if(pinnedBB & BoardUtils::bits[sq]) bishopMoves &= BoardUtils::lineBB[kingSquare][sq];
 
-        // we can always move the king to a safe square
-        if(from == kingSquare) {
-            if(this->isAttacked(to) == false) moves[num++] = pseudoLegalMoves[idx];
-            continue;
-        }
+        num = this->addPieceMoves<Us>(moves, num, sq, bishopMoves);
+        bishopsQueens &= (bishopsQueens-1);
+    }
 
-        // single check, can capture the attacker or intercept the check only if the moving piece is not pinned
-        if(checkingPiecesCnt == 1 && ((pinnedBB & BoardUtils::bits[from]) == 0)) {
+    // -----castles-----
+    // the king can't castle out of, through or into check
+    if(quiets && !checkersBB) {
+        constexpr int allowedCastles = (Us == White ? 3 : 12);
+        for(int i = 0; i < 4; i++) {
+            if(!(this->castleRights & allowedCastles & BoardUtils::bits[i]) || (allPiecesBB & BoardUtils::castleMask[i])) continue;
 
-            // capturing the checking pawn by en passant (special case)
-            if(MoveUtils::isEP(pseudoLegalMoves[idx]) && checkingPieceIndex == to + (color == White ? south: north))
-                moves[num++] = pseudoLegalMoves[idx];
+            assert(this->squares[BoardUtils::castleStartSq[i]] == (King | (int)Us));
 
-            // check ray includes interception or capturing the attacker
-            else if(checkRayBB & BoardUtils::bits[to]) {
-                moves[num++] = pseudoLegalMoves[idx];
-            }
-        }
+            int first = min(BoardUtils::castleStartSq[i], BoardUtils::castleEndSq[i]);
+            int second = max(BoardUtils::castleStartSq[i], BoardUtils::castleEndSq[i]);
 
-        // no checks, every piece can move if it is not pinned or it moves in the direction of the pin
-        if(checkingPiecesCnt == 0) {
-            // not pinned
-            if((pinnedBB & BoardUtils::bits[from]) == 0)
-                moves[num++] = pseudoLegalMoves[idx];
+            bool ok = true;
+            for(int sq = first; sq <= second && ok; sq++)
+                if(this->isAttacked<Us>(sq, allPiecesBB)) ok = false;
 
-            // pinned, can only move in the pin direction
-            else if(abs(BoardUtils::direction(from, to)) == abs(BoardUtils::direction(from, kingSquare)))
-                moves[num++] = pseudoLegalMoves[idx];
+            if(ok) moves[num++] = MoveUtils::getMove(BoardUtils::castleStartSq[i], BoardUtils::castleEndSq[i], MoveUtils::CASTLE);
         }
     }
 
-    // en passant are the last added pseudo legal moves
-    int epMoves[2];
-    int numEp = 0;
-    while(num && MoveUtils::isEP(moves[num-1])) {
-        epMoves[numEp++] = moves[--num];
+    // -----en passant-----
+    // rare enough that we just make the move on the occupancy and look for attackers of the king
+    // (this covers evasions, diagonal pins and the horizontal pin when both pawns leave the rank)
+    if(this->ep != -1) {
+        int capturedPawnSquare = this->ep - pawnDir;
+        U64 epBB = ((Us == White ? BoardUtils::blackPawnAttacksBB[this->ep] : BoardUtils::whitePawnAttacksBB[this->ep]) & ourPawnsBB);
+        while(epBB) {
+            int sq = MagicBitboardUtils::bitscanForward(epBB);
+
+            assert(this->squares[sq] == (Pawn | (int)Us));
+
+            U64 occ = ((allPiecesBB ^ BoardUtils::bits[sq] ^ BoardUtils::bits[capturedPawnSquare]) | BoardUtils::bits[this->ep]);
+            if((this->attackersTo(kingSquare, occ) & opponentPiecesBB & ~BoardUtils::bits[capturedPawnSquare]) == 0)
+                moves[num++] = MoveUtils::getMove(sq, this->ep, MoveUtils::EN_PASSANT);
+
+            epBB &= (epBB-1);
+        }
     }
 
-    assert(numEp <= 2);
+    return num;
+}
 
-    // ep horizontal pin
-    for(int idx = 0; idx < numEp; idx++) {
-        int from = MoveUtils::getFromSq(epMoves[idx]);
-        int to = MoveUtils::getToSq(epMoves[idx]);
+// the side to move is dispatched once, the generator itself is specialised for each color
+HOT_KERNEL int Board::generateLegalMoves(Move *moves) {
+    PROFILE_SCOPE(PROFILE_GENERATE_MOVES);
+    return (this->turn == White ? this->generateMoves<White>(moves, true) : this->generateMoves<Black>(moves, true));
+}
 
-        int epRank = (from >> 3);
-        int otherPawnSquare = (epRank << 3) | (to & 7);
-        U64 rooksQueens = (opponentPiecesBB & (this->rooksBB | this->queensBB) & BoardUtils::ranksBB[epRank]);
+// captures and promotions only
+HOT_KERNEL int Board::generateLegalMovesQS(Move *moves) {
+    PROFILE_SCOPE(PROFILE_GENERATE_MOVES_QS);
+    return (this->turn == White ? this->generateMoves<White>(moves, false) : this->generateMoves<Black>(moves, false));
+}
 
-        // remove the 2 pawns and compute attacks from rooks/queens on king square
-        U64 removeWhite = BoardUtils::bits[from], 
-            removeBlack = BoardUtils::bits[otherPawnSquare];
-        if(color == Black) swap(removeWhite, removeBlack);
+#if VALIDATE_INCREMENTAL
+// validates the board when the make or unmake that created it returns
+struct ValidateOnExit {
+    Board *b;
+    Move move;
+    const char *action;
+    string fenBefore;
+
+    ValidateOnExit(Board *b, Move move, const char *action) : b(b), move(move), action(action), fenBefore(b->getFenFromCurrPos()) {}
+    ~ValidateOnExit() { b->validate(move, action, fenBefore); }
+};
+#define VALIDATE_ON_EXIT(move, action) ValidateOnExit validateOnExit(this, move, action)
+
+// recomputes everything that is updated incrementally and aborts on the first difference
+void Board::validate(Move move, const char *action, const string &fenBefore) {
+    string error;
+
+    // the mailbox, the bitboards and the king squares
+    U64 byTypeFromSquares[7] = {}, byColorFromSquares[2] = {};
+    int pieceCountFromSquares[16] = {};
+    for(int sq = 0; sq < 64; sq++) {
+        if(this->squares[sq] == Empty) continue;
+        int color = (this->squares[sq] & 8), piece = (this->squares[sq] & 7);
+
+        byTypeFromSquares[piece] |= (1ULL << sq);
+        byColorFromSquares[(int)(color == White)] |= (1ULL << sq);
+        pieceCountFromSquares[color | piece]++;
+    }
+    for(int piece = Pawn; piece <= King; piece++)
+        if(this->byType[piece] != byTypeFromSquares[piece]) error = "byType[" + to_string(piece) + "] doesn't match the mailbox";
+    for(int c = 0; c < 2; c++)
+        if(this->byColor[c] != byColorFromSquares[c]) error = "byColor[" + to_string(c) + "] doesn't match the mailbox";
+    if(this->squares[this->whiteKingSquare] != (King | (int)White) || this->squares[this->blackKingSquare] != (King | (int)Black))
+        error = "the king squares don't match the mailbox";
+
+    // the keys
+    U64 pawnKeyFromSquares = 0, materialKeyFromCounts = 0;
+    for(int sq = 0; sq < 64; sq++)
+        if((this->squares[sq] & 7) == Pawn) pawnKeyFromSquares ^= TranspositionTable::pieceZobristNumbers[Pawn][(int)((this->squares[sq] & 8) == White)][sq];
+    for(int color: {Black, White}) {
+        for(int piece = Pawn; piece <= King; piece++) {
+            if(this->pieceCount[color | piece] != pieceCountFromSquares[color | piece]) error = "pieceCount[" + to_string(color | piece) + "] is wrong";
+            for(int i = 0; i < pieceCountFromSquares[color | piece]; i++)
+                materialKeyFromCounts ^= TranspositionTable::materialZobristNumbers[piece][(int)(color == White)][i];
+        }
+    }
+    if(this->hashKey != this->getZobristHashFromCurrPos()) error = "hashKey is wrong";
+    if(this->pawnKey != pawnKeyFromSquares) error = "pawnKey is wrong";
+    if(this->materialKey != materialKeyFromCounts) error = "materialKey is wrong";
+
+    // the checkers
+    int kingSquare = (this->turn == White ? this->whiteKingSquare : this->blackKingSquare);
+    if(this->checkersBB != (this->attackersTo(kingSquare, this->occupiedBB()) & this->piecesBB(this->turn ^ 8)))
+        error = "checkersBB is wrong";
+
+    // the nnue accumulator
+    if(NNUE::isActive()) {
+        NNUE::Accumulator fresh;
+        NNUE::refresh(this, fresh, White);
+        NNUE::refresh(this, fresh, Black);
+        if(memcmp(fresh.values, this->accumulatorStk[this->accumulatorIndex].values, sizeof(fresh.values)))
+            error = "the nnue accumulator is wrong";
+    }
 
-        this->whitePiecesBB ^= removeWhite;
-        this->blackPiecesBB ^= removeBlack;
+    if(error.empty()) return;
 
-        U64 attacks = this->attacksTo(kingSquare);
-        if((rooksQueens & attacks) == 0) moves[num++] = epMoves[idx];
+    cout << "info string incremental state mismatch after " << action << " " << BoardUtils::moveToString(move)
+         << " from " << fenBefore << ": " << error << " (fen now " << this->getFenFromCurrPos() << ")\n";
+    cout.flush();
+    abort();
+}
+#else
+#define VALIDATE_ON_EXIT(move, action)
+#endif
+
+// the stacks hold the game moves (at most half of them, see dropOldStates) and the search moves,
+// running out of them means a bug, so the engine stops instead of writing past them
+void Board::stackOverflow(const char *stack) {
+    cerr << "the " << stack << " stack is full (" << this->stateIndex << " states): " << this->getFenFromCurrPos() << endl;
+    abort();
+}
 
-        this->whitePiecesBB ^= removeWhite;
-        this->blackPiecesBB ^= removeBlack;
+// the game moves are never taken back, so the states older than the last capture or pawn move
+// (which the repetition detection can't reach) are dropped, and at most half of the stacks are kept for the game
+void Board::dropOldStates() {
+    int keep = min({(int)this->halfmoveClock, this->stateIndex, STATE_STACK_SIZE / 2});
+    if(keep < this->stateIndex) {
+        copy(this->stateStk + this->stateIndex - keep, this->stateStk + this->stateIndex, this->stateStk);
+        this->stateIndex = keep;
     }
 
-    // put the king back
-    if(color == White) this->whitePiecesBB ^= BoardUtils::bits[kingSquare];
-    else this->blackPiecesBB ^= BoardUtils::bits[kingSquare];
+    this->accumulatorStk[0] = this->accumulatorStk[this->accumulatorIndex];
+    this->accumulatorIndex = 0;
+}
 
-    return num;
+// push the state from before a move on the stack
+void Board::saveState(Move move, int capturedPiece) {
+    if(this->stateIndex >= STATE_STACK_SIZE) stackOverflow("state");
+    StateInfo &st = this->stateStk[this->stateIndex++];
+
+    st.hashKey = this->hashKey;
+    st.pawnKey = this->pawnKey;
+    st.materialKey = this->materialKey;
+    st.checkersBB = this->checkersBB;
+    st.castleRights = this->castleRights;
+    st.ep = this->ep;
+    st.capturedPiece = capturedPiece;
+    st.halfmoveClock = this->halfmoveClock;
+    st.move = move;
+}
+
+// pop the state from before the last move
+void Board::restoreState() {
+    assert(stateIndex > 0);
+    const StateInfo &st = this->stateStk[--this->stateIndex];
+
+    this->hashKey = st.hashKey;
+    this->pawnKey = st.pawnKey;
+    this->materialKey = st.materialKey;
+    this->checkersBB = st.checkersBB;
+    this->castleRights = st.castleRights;
+    this->ep = st.ep;
+    this->halfmoveClock = st.halfmoveClock;
 }
 
 // make a move, updating the squares and bitboards
-void Board::makeMove(int move) {
-    this->updateHashKey(move);
+HOT_KERNEL void Board::makeMove(Move move) {
+    PROFILE_SCOPE(PROFILE_MAKE_MOVE);
+    VALIDATE_ON_EXIT(move, "makeMove");
+
+#if COPY_MAKE
+    if(this->stateIndex >= STATE_STACK_SIZE) stackOverflow("state");
+    this->positionStk[this->stateIndex] = *this;
+#endif
 
     if(move == MoveUtils::NO_MOVE) { // null move
-        epStk.push(this->ep);
+        this->saveState(move, Empty);
+        this->updateHashKey(move);
+
         this->ep = -1;
         this->turn ^= 8;
+        this->halfmoveClock++;
+
+        // null moves are only made when not in check, so the opponent can't be in check either
+        this->checkersBB = 0;
 
         return;
     }
 
-    repetitionMap[repetitionIndex++] = hashKey;
-
-    // push the current castle and ep info in order to retrieve it when we unmake the move
-    castleStk.push(this->castleRights);
-    epStk.push(this->ep);
-
-    moveStk.push(move);
+    if(this->turn == White) this->makeMove<White>(move);
+    else this->makeMove<Black>(move);
+}
 
-    // get move info
+template<Color Us> HOT_INLINE inline void Board::makeMove(Move move) {
+    // get move info (the pieces are read from the board before it changes)
     int from = MoveUtils::getFromSq(move);
     int to = MoveUtils::getToSq(move);
 
-    int color = MoveUtils::getColor(move);
-    int piece = MoveUtils::getPiece(move);
-    int otherColor = (color ^ 8);
-    int otherPiece = MoveUtils::getCapturedPiece(move);
+    constexpr Color Them = (Us == White ? Black : White);
+    int piece = this->movedPiece(move);
+    int otherPiece = this->capturedPiece(move);
     int promotionPiece = MoveUtils::getPromotionPiece(move);
 
     bool isMoveEP = MoveUtils::isEP(move);
-    bool isMoveCapture = MoveUtils::isCapture(move);
+    bool isMoveCapture = (otherPiece != Empty);
     bool isMoveCastle = MoveUtils::isCastle(move);
 
+    // save the state in order to restore it when we unmake the move
+    // the hash keys are updated while the pieces are still on their squares
+    this->saveState(move, otherPiece);
+    this->updateHashKey(move);
+
+    this->halfmoveClock = ((piece == Pawn || isMoveCapture) ? 0 : this->halfmoveClock + 1);
+
     // update bitboards
-    this->updatePieceInBB(piece, color, from);
-    if(!isMoveEP && isMoveCapture) this->updatePieceInBB(otherPiece, otherColor, to);
-    if(!promotionPiece) this->updatePieceInBB(piece, color, to);
+    this->updatePieceInBB<Us>(piece, from);
+    if(!isMoveEP && isMoveCapture) this->updatePieceInBB<Them>(otherPiece, to);
+    if(!promotionPiece) this->updatePieceInBB<Us>(piece, to);
+
+    // update material
+    if(isMoveCapture) this->removeMaterial(otherPiece, Them);
+    if(promotionPiece) {
+        this->removeMaterial(Pawn, Us);
+        this->addMaterial(promotionPiece, Us);
+    }
 
     this->squares[to] = this->squares[from];
     this->squares[from] = Empty;
 
     // promote pawn
     if(promotionPiece) {
-        this->updatePieceInBB(promotionPiece, color, to);
-        this->squares[to] = (promotionPiece | color);
+        this->updatePieceInBB<Us>(promotionPiece, to);
+        this->squares[to] = (promotionPiece | Us);
     }
 
     if(piece == King) {
         // bit mask for removing castle rights
-        int mask = (color == White ? 12 : 3);
+        constexpr int mask = (Us == White ? 12 : 3);
         this->castleRights &= mask;
 
-        if(color == White) this->whiteKingSquare = to;
+        if(Us == White) this->whiteKingSquare = to;
         else this->blackKingSquare = to;
     }
 
@@ -992,78 +829,100 @@ void Board::makeMove(int move) {
         int rookStartSquare = (rank << 3) + (file == 6 ? 7 : 0);
         int rookEndSquare = (rank << 3) + (file == 6 ? 5 : 3);
 
-        this->movePieceInBB(Rook, color, rookStartSquare, rookEndSquare);
+        this->movePieceInBB<Us>(Rook, rookStartSquare, rookEndSquare);
         swap(this->squares[rookStartSquare], this->squares[rookEndSquare]);
     }
 
     // remove the captured pawn if en passant
     if(isMoveEP) {
-        int capturedPawnSquare = to+(color == White ? south : north);
+        int capturedPawnSquare = to+(Us == White ? south : north);
 
-        this->updatePieceInBB(Pawn, otherColor, capturedPawnSquare);
+        this->updatePieceInBB<Them>(Pawn, capturedPawnSquare);
         this->squares[capturedPawnSquare] = Empty;
     }
 
     this->ep = -1;
     if(piece == Pawn && abs(from-to) == 16)
-        this->ep = to+(color == White ? -8 : 8);
+        this->ep = to+(Us == White ? -8 : 8);
+
+    // push the updated nnue accumulator (king squares are already updated)
+    if(NNUE::isActive()) {
+        if(this->accumulatorIndex+1 >= NNUE::STACK_SIZE) stackOverflow("accumulator");
+        NNUE::update(this, accumulatorStk[accumulatorIndex], accumulatorStk[accumulatorIndex+1], move, piece, otherPiece);
+        accumulatorIndex++;
+    }
 
     // switch turn
     this->turn ^= (Black | White);
+
+    // checkers of the new side to move, used by isInCheck and move generation
+    int theirKingSquare = (Us == White ? this->blackKingSquare : this->whiteKingSquare);
+    this->checkersBB = (this->attackersTo(theirKingSquare, this->occupiedBB()) & this->piecesBB(Us));
 }
 
-// basically the inverse of makeMove but we take the previous en passant square and castling rights from the stacks
-void Board::unmakeMove(int move) {
-    assert(epStk.top() >= -1 && epStk.top() < 64);
+// basically the inverse of makeMove but the hash keys, castling rights, en passant square etc. are restored from the state stack
+HOT_KERNEL void Board::unmakeMove(Move move) {
+    PROFILE_SCOPE(PROFILE_UNMAKE_MOVE);
+    VALIDATE_ON_EXIT(move, "unmakeMove");
+
+#if COPY_MAKE
+    // the indices are restored like with unmake (null moves don't push an accumulator)
+    assert(stateIndex > 0);
+    static_cast<Position&>(*this) = this->positionStk[--this->stateIndex];
+    if(move != MoveUtils::NO_MOVE && NNUE::isActive()) accumulatorIndex--;
+    return;
+#endif
 
     if(move == MoveUtils::NO_MOVE) { // null move
-        this->ep = epStk.top();
-        epStk.pop();
         this->turn ^= 8;
-
-        this->updateHashKey(move);
+        this->restoreState();
 
         return;
     }
 
-    repetitionIndex--;
+    // the move was made by the side that isn't to move anymore
+    if(this->turn == Black) this->unmakeMove<White>(move);
+    else this->unmakeMove<Black>(move);
+}
+
+template<Color Us> HOT_INLINE inline void Board::unmakeMove(Move move) {
+    constexpr Color Them = (Us == White ? Black : White);
+
+    // the previous accumulator is still on the stack
+    if(NNUE::isActive()) accumulatorIndex--;
 
     // get move info
     int from = MoveUtils::getFromSq(move);
     int to = MoveUtils::getToSq(move);
 
-    int color = MoveUtils::getColor(move);
-    int piece = MoveUtils::getPiece(move);
-    int otherColor = (color ^ 8);
-    int otherPiece = MoveUtils::getCapturedPiece(move);
     int promotionPiece = MoveUtils::getPromotionPiece(move);
+    int piece = (promotionPiece ? Pawn : (this->squares[to] & (~8)));
+    int otherPiece = this->stateStk[this->stateIndex-1].capturedPiece;
 
     bool isMoveEP = MoveUtils::isEP(move);
-    bool isMoveCapture = MoveUtils::isCapture(move);
+    bool isMoveCapture = (otherPiece != Empty);
     bool isMoveCastle = MoveUtils::isCastle(move);
 
-    // retrieve previous castle and ep info
-    this->ep = epStk.top();
-    this->castleRights = castleStk.top();
-    epStk.pop();
-    castleStk.pop();
-    
-    moveStk.pop();
-
     if(piece == King) {
-        if(color == White) this->whiteKingSquare = from;
-        if(color == Black) this->blackKingSquare = from;
+        if(Us == White) this->whiteKingSquare = from;
+        else this->blackKingSquare = from;
     }
 
-    this->updatePieceInBB((this->squares[to] ^ color), color, to);
+    this->updatePieceInBB<Us>((this->squares[to] ^ Us), to);
 
-    if(promotionPiece) this->squares[to] = (Pawn | color);
+    if(promotionPiece) {
+        this->squares[to] = (Pawn | (int)Us);
+
+        this->removeMaterial(promotionPiece, Us);
+        this->addMaterial(Pawn, Us);
+    }
+    if(isMoveCapture) this->addMaterial(otherPiece, Them);
 
-    this->updatePieceInBB(piece, color, from);
-    if(isMoveCapture && !isMoveEP) this->updatePieceInBB(otherPiece, otherColor, to);
+    this->updatePieceInBB<Us>(piece, from);
+    if(isMoveCapture && !isMoveEP) this->updatePieceInBB<Them>(otherPiece, to);
 
     this->squares[from] = this->squares[to];
-    if(isMoveCapture) this->squares[to] = (otherPiece | otherColor);
+    if(isMoveCapture) this->squares[to] = (otherPiece | Them);
     else this->squares[to] = Empty;
 
     if(isMoveCastle) {
@@ -1071,54 +930,110 @@ void Board::unmakeMove(int move) {
         int rookStartSquare = (rank << 3) + (file == 6 ? 7 : 0);
         int rookEndSquare = (rank << 3) + (file == 6 ? 5 : 3);
 
-        this->movePieceInBB(Rook, color, rookEndSquare, rookStartSquare);
+        this->movePieceInBB<Us>(Rook, rookEndSquare, rookStartSquare);
         swap(this->squares[rookStartSquare], this->squares[rookEndSquare]);
     }
 
     if(isMoveEP) {
-        int capturedPawnSquare = to+(color == White ? south : north);
+        int capturedPawnSquare = to+(Us == White ? south : north);
 
-        this->updatePieceInBB(Pawn, otherColor, capturedPawnSquare);
-        this->squares[capturedPawnSquare] = (otherColor | Pawn);
+        this->updatePieceInBB<Them>(Pawn, capturedPawnSquare);
+        this->squares[capturedPawnSquare] = ((int)Them | Pawn);
         this->squares[to] = Empty;
     }
 
     this->turn ^= (Black | White);
 
-    this->updateHashKey(move);
+    this->restoreState();
 }
 
-bool Board::checkRepetition() {
-    for(int i = repetitionIndex-2; i >= 0; i -= 2) {
-        if(repetitionMap[i] == hashKey) return true;
+// the positions since the last capture or pawn move (and since the last null move) with the same side to move are
+// compared, from the state stack, which also holds the game moves; ply is the distance from the root of the search
+bool Board::checkRepetition(int ply) {
+    int end = min((int)this->halfmoveClock, this->stateIndex);
+    int repetitions = 0;
+
+    for(int i = 2; i <= end; i += 2) {
+        const StateInfo &prev = this->stateStk[this->stateIndex - i], &next = this->stateStk[this->stateIndex - i + 1];
+        if(prev.move == MoveUtils::NO_MOVE || next.move == MoveUtils::NO_MOVE) break;
+
+        // a position repeated once inside the search is a draw (the side that could avoid it would have),
+        // a repetition of a position from before the root has to be the third occurrence
+        if(prev.hashKey == this->hashKey && (i < ply || ++repetitions == 2)) return true;
     }
 
     return false;
 }
 
-// draw by insufficient material or repetition
-bool Board::isDraw() {
-    if(checkRepetition()) return true;
+// if the side to move has a reversible move back to a position of the last plies (Marcel van Kervinck's cuckoo
+// tables), it can force a repetition, so the position is at least a draw
+bool Board::hasUpcomingRepetition(int ply) {
+    PROFILE_SCOPE(PROFILE_UPCOMING_REPETITION);
+
+    int end = min((int)this->halfmoveClock, this->stateIndex);
+    if(end < 3 || this->stateStk[this->stateIndex - 1].move == MoveUtils::NO_MOVE) return false;
+
+    // the moves of the opponent since then have to cancel out, so that the positions only differ by one of our moves
+    U64 opponentMovesKey = (this->hashKey ^ this->stateStk[this->stateIndex - 1].hashKey ^ TranspositionTable::blackTurnZobristNumber);
 
-    if(this->queensBB | this->rooksBB | this->pawnsBB) return false;
+    for(int i = 3; i <= end; i += 2) {
+        const StateInfo &prev = this->stateStk[this->stateIndex - i], &next = this->stateStk[this->stateIndex - i + 1];
+        if(prev.move == MoveUtils::NO_MOVE || next.move == MoveUtils::NO_MOVE) break;
 
-    if((this->knightsBB | this->bishopsBB) == 0) return true; // king vs king
+        opponentMovesKey ^= (next.hashKey ^ prev.hashKey ^ TranspositionTable::blackTurnZobristNumber);
+        if(opponentMovesKey) continue;
 
-    int whiteBishops = MagicBitboardUtils::popcount(this->bishopsBB | this->whitePiecesBB);
-    int blackBishops = MagicBitboardUtils::popcount(this->bishopsBB | this->blackPiecesBB);
-    int whiteKnights = MagicBitboardUtils::popcount(this->knightsBB | this->whitePiecesBB);
-    int blackKnights = MagicBitboardUtils::popcount(this->knightsBB | this->blackPiecesBB);
+        U64 moveKey = (this->hashKey ^ prev.hashKey);
+        int j = TranspositionTable::cuckooH1(moveKey);
+        if(TranspositionTable::cuckooKeys[j] != moveKey) j = TranspositionTable::cuckooH2(moveKey);
+        if(TranspositionTable::cuckooKeys[j] != moveKey) continue;
 
-    if(whiteKnights + blackKnights + whiteBishops + blackBishops == 1) return true; // king and minor piece vs king
+        // the squares between have to be empty for the move to be possible
+        Move move = TranspositionTable::cuckooMoves[j];
+        int s1 = MoveUtils::getFromSq(move), s2 = MoveUtils::getToSq(move);
+        if(BoardUtils::betweenBB[s1][s2] & this->occupiedBB()) continue;
 
-    if(whiteKnights + blackKnights == 0 && whiteBishops == 1 && blackBishops == 1) {
-        int lightSquareBishops = MagicBitboardUtils::popcount(BoardUtils::lightSquaresBB & this->bishopsBB);
-        if(lightSquareBishops == 0 || lightSquareBishops == 2) return true; // king and bishop vs king and bishop with same color bishops
+        // repeating a position of the search is enough
+        if(i < ply) return true;
+
+        // before the root the move has to be ours (not the opponent's move to the current position),
+        // and the position has to have occurred before, so that it is the third occurrence
+        int piece = (this->squares[s1] != Empty ? this->squares[s1] : this->squares[s2]);
+        if((piece & 8) != this->turn) continue;
+
+        int first = this->stateIndex - i;
+        int endBefore = min(prev.halfmoveClock, first);
+        for(int k = 2; k <= endBefore; k += 2) {
+            if(this->stateStk[first - k].move == MoveUtils::NO_MOVE || this->stateStk[first - k + 1].move == MoveUtils::NO_MOVE) break;
+            if(this->stateStk[first - k].hashKey == prev.hashKey) return true;
+        }
     }
 
     return false;
 }
 
+// draw by insufficient material or repetition
+bool Board::isDraw(int ply) {
+    PROFILE_SCOPE(PROFILE_IS_DRAW);
+
+    // fifty-move rule, unless the move that reached it was checkmate
+    if(this->halfmoveClock >= 100) {
+        Move moves[256];
+        if(!this->checkersBB || this->generateLegalMoves(moves)) return true;
+    }
+
+    if(this->halfmoveClock >= 4 && checkRepetition(ply)) return true;
+
+    // insufficient material only depends on the material signature
+    Material::Entry *me = Material::probe(this);
+    if(me->drawType == Material::DRAW_NONE) return false;
+    if(me->drawType == Material::DRAW_ALWAYS) return true; // king vs king or king and minor piece vs king
+
+    // kings and bishops, all of them on the same color
+    int lightSquareBishops = MagicBitboardUtils::popcount(BoardUtils::lightSquaresBB & this->byType[Bishop]);
+    return (lightSquareBishops == 0 || lightSquareBishops == MagicBitboardUtils::popcount(this->byType[Bishop]));
+}
+
 
 // xor zobrist numbers corresponding to all features of the current position
 U64 Board::getZobristHashFromCurrPos() {
@@ -1138,8 +1053,9 @@ U64 Board::getZobristHashFromCurrPos() {
     return key;
 }
 
-// update the hash key after making a move
-void Board::updateHashKey(int move) {
+// update the hash keys (position and pawns) after making a move
+// the pieces are read from the board, so it is called while they are on their squares from before the move
+void Board::updateHashKey(Move move) {
     if(move == MoveUtils::NO_MOVE) { // null move
         if(this->ep != -1) this->hashKey ^= TranspositionTable::epZobristNumbers[this->ep % 8];
         this->hashKey ^= TranspositionTable::blackTurnZobristNumber;
@@ -1150,13 +1066,13 @@ void Board::updateHashKey(int move) {
     int from = MoveUtils::getFromSq(move);
     int to = MoveUtils::getToSq(move);
 
-    int color = MoveUtils::getColor(move);
-    int piece = MoveUtils::getPiece(move);
+    int color = (this->squares[from] & 8);
+    int piece = this->movedPiece(move);
     int otherColor = (color ^ 8);
-    int otherPiece = MoveUtils::getCapturedPiece(move);
+    int otherPiece = this->capturedPiece(move);
 
     bool isMoveEP = MoveUtils::isEP(move);
-    bool isMoveCapture = MoveUtils::isCapture(move);
+    bool isMoveCapture = (otherPiece != Empty);
     bool isMoveCastle = MoveUtils::isCastle(move);
     int promotionPiece = MoveUtils::getPromotionPiece(move);
 
@@ -1169,6 +1085,13 @@ void Board::updateHashKey(int move) {
     if(!promotionPiece) this->hashKey ^= TranspositionTable::pieceZobristNumbers[piece][(int)(color == White)][to];
     else this->hashKey ^= TranspositionTable::pieceZobristNumbers[promotionPiece][(int)(color == White)][to];
 
+    // the pawn key only has the pawns
+    if(piece == Pawn) {
+        this->pawnKey ^= TranspositionTable::pieceZobristNumbers[Pawn][(int)(color == White)][from];
+        if(!promotionPiece) this->pawnKey ^= TranspositionTable::pieceZobristNumbers[Pawn][(int)(color == White)][to];
+    }
+    if(otherPiece == Pawn) this->pawnKey ^= TranspositionTable::pieceZobristNumbers[Pawn][(int)(otherColor == White)][capturedPieceSquare];
+
     // castle stuff
     int newCastleRights = this->castleRights;
     if(piece == King) {
@@ -4,43 +4,109 @@
 #define BOARD_H_
 
 #include <string>
-#include <stack>
+
+#include "NNUE.h"
+#include "MoveUtils.h"
+#include "Enums.h"
 
 using namespace std;
 
 typedef unsigned long long U64;
 
-class Board {
+// everything that can't be recovered when a move is unmade, saved before every move (null moves included)
+struct StateInfo {
+    U64 hashKey, pawnKey, materialKey;
+    U64 checkersBB;
+    int castleRights, ep;
+    int capturedPiece;
+    int halfmoveClock;
+    Move move; // the move made from this state
+};
+
+// everything that makeMove changes, the stacks only hold pointers to the arrays of the board
+// with copy-make this is saved before every move and copied back to take the move back
+struct Position {
+    // the pieces are stored both in a mailbox (color | piece) and in bitboards,
+    // which are indexed by piece type (byType[Empty] is unused) and by (color == White)
+    uint8_t squares[64];
+    U64 byType[7], byColor[2];
+
+    U64 hashKey, pawnKey, materialKey;
+    U64 checkersBB; // pieces giving check to the side to move
+
+    uint8_t pieceCount[16]; // indexed by (color | piece)
+
+    uint8_t turn;
+    uint8_t whiteKingSquare, blackKingSquare;
+    int8_t ep;
+    uint8_t castleRights; // bit 0 -> white short, 1 -> white long, 2 -> black short, 3 -> black long
+    uint16_t halfmoveClock; // plies since the last capture or pawn move
+};
+
+// the mailbox and the bitboards alone take 136 bytes, everything else fits in the rest of a third cache line
+static_assert(sizeof(Position) <= 192, "a position should fit in three cache lines");
+
+// what the side to move needs to know if a move gives check, computed once per node by checkInfo
+struct CheckInfo {
+    U64 checkSquaresBB[7]; // squares from which every piece type (by type, with the current occupancy) attacks the enemy king
+    U64 discoverersBB; // our pieces that are the only blocker between one of our sliders and the enemy king
+    int kingSquare; // of the enemy king
+};
+
+// moves are taken back with unmakeMove, or by copying the position from before the move if this is 1
+#ifndef COPY_MAKE
+#define COPY_MAKE 0
+#endif
+
+// after every make and unmake the incremental state is checked against a recomputation from scratch if this is 1
+#ifndef VALIDATE_INCREMENTAL
+#define VALIDATE_INCREMENTAL 0
+#endif
+
+class Board : public Position {
 private:
-    stack<int> epStk, castleStk;
+    static const int STATE_STACK_SIZE = 1024;
 
-    int pseudoLegalMoves[512];
-    short generatePseudoLegalMoves();
-    short generatePseudoLegalMovesQS();
+#if COPY_MAKE
+    Position *positionStk; // indexed like the state stack
+#endif
 
-    void updateHashKey(int move);
-    void updatePieceInBB(int piece, int color, int sq);
-    void movePieceInBB(int piece, int color, int from, int to);
-    bool checkRepetition();
+    U64 attackersTo(int sq, U64 occ);
+    U64 pinnedPieces(int kingSquare, U64 ourPiecesBB, U64 opponentPiecesBB);
+    template<Color Us> bool isAttacked(int sq, U64 allPiecesBB);
+
+    // the hot routines are specialised for the side to move, so that pawn directions, ranks, king squares
+    // and castling masks are compile time constants
+    template<Color Us> int addPawnMoves(Move *moves, int num, U64 targets, int dir, U64 pinnedBB, int kingSquare);
+    template<Color Us> int addPieceMoves(Move *moves, int num, int from, U64 targets);
+    template<Color Us> int generateMoves(Move *moves, bool quiets);
+
+    template<Color Us> void makeMove(Move move);
+    template<Color Us> void unmakeMove(Move move);
+
+    void saveState(Move move, int capturedPiece);
+    void restoreState();
+    [[noreturn]] void stackOverflow(const char *stack);
+    void updateHashKey(Move move);
+    template<Color C> void updatePieceInBB(int piece, int sq);
+    template<Color C> void movePieceInBB(int piece, int from, int to);
+    void addMaterial(int piece, int color);
+    void removeMaterial(int piece, int color);
+    bool checkRepetition(int ply);
 public:
     Board();
+    Board(const Board &other); // a copy with its own stacks, for worker threads
     ~Board();
+    Board &operator=(const Board &other) = delete;
 
-    int squares[64], turn;
-    int whiteKingSquare, blackKingSquare;
-    int ep;
-    int repetitionIndex;
-    int castleRights; // bit 0 -> white short, 1 -> white long, 2 -> black short, 3 -> black long
-
-    U64 pawnsBB, knightsBB, bishopsBB, rooksBB, queensBB;
-    U64 blackPiecesBB, whitePiecesBB;
-    U64 hashKey;
-
-    stack<int> moveStk;
-    U64 *repetitionMap;
+    // the states of the game moves (made by the position command) and of the search, used to find repetitions
+    StateInfo *stateStk;
+    NNUE::Accumulator *accumulatorStk;
+    int stateIndex, accumulatorIndex; // indices in the stacks
 
     void clear();
-
+    void refreshAccumulator();
+    void dropOldStates();
 
     void loadFenPos(string input);
     string getFenFromCurrPos();
@@ -49,13 +115,33 @@ public:
     U64 attacksTo(int sq);
     bool isAttacked(int sq);
     bool isInCheck();
-    bool isDraw();
+    bool isDraw(int ply);
+    bool hasUpcomingRepetition(int ply);
 
-    int generateLegalMoves(int *moves);
-    int generateLegalMovesQS(int *moves);
+    inline U64 piecesBB(int color) { return this->byColor[(int)(color == White)]; }
+    inline U64 occupiedBB() { return (this->byColor[0] | this->byColor[1]); }
 
-    void makeMove(int move);
-    void unmakeMove(int move);
+    // the moved and captured pieces of a move that hasn't been made yet
+    inline int movedPiece(Move move) { return (this->squares[MoveUtils::getFromSq(move)] & (~8)); }
+    inline int capturedPiece(Move move) { return (MoveUtils::isEP(move) ? Pawn : (this->squares[MoveUtils::getToSq(move)] & (~8))); }
+    inline bool isCapture(Move move) { return (this->capturedPiece(move) != Empty); }
+
+    // the last move made on the board (NO_MOVE after a null move or if there is none)
+    inline Move lastMove() { return (this->stateIndex ? this->stateStk[this->stateIndex-1].move : MoveUtils::NO_MOVE); }
+
+    int generateLegalMoves(Move *moves);
+    int generateLegalMovesQS(Move *moves);
+
+    // checks of the side to move, so a move can be known to give check before it is made
+    void checkInfo(CheckInfo &ci);
+    bool givesCheck(Move move, const CheckInfo &ci);
+
+    void makeMove(Move move);
+    void unmakeMove(Move move);
+
+#if VALIDATE_INCREMENTAL
+    void validate(Move move, const char *action, const string &fenBefore);
+#endif
 };
 
 void init();
@@ -7,22 +7,11 @@
 #include <cassert>
 using namespace std;
 
-U64 BoardUtils::bits[64], BoardUtils::filesBB[8], BoardUtils::ranksBB[8], BoardUtils::knightAttacksBB[64], BoardUtils::kingAttacksBB[64], BoardUtils::whitePawnAttacksBB[64], BoardUtils::blackPawnAttacksBB[64];
-U64 BoardUtils::squaresNearWhiteKing[64], BoardUtils::squaresNearBlackKing[64];
-U64 BoardUtils::lightSquaresBB, BoardUtils::darkSquaresBB;
-U64 BoardUtils::bishopMasks[64], BoardUtils::rookMasks[64], BoardUtils::castleMask[4];
-
 const int BoardUtils::castleStartSq[4] = {e1, e1, e8, e8};
 const int BoardUtils::castleEndSq[4] = {g1, c1, g8, c8};
 
-// functions that return the board shifted in a direction
-U64 BoardUtils::eastOne(U64 bb) { return ((bb << 1) & (~filesBB[0])); }
-U64 BoardUtils::westOne(U64 bb) { return ((bb >> 1) & (~filesBB[7])); }
-U64 BoardUtils::northOne(U64 bb) { return (bb << 8); }
-U64 BoardUtils::southOne(U64 bb) { return (bb >> 8); }
-
 // returns the algebraic notation for a move
-string BoardUtils::moveToString(int move) {
+string BoardUtils::moveToString(Move move) {
     int from = MoveUtils::MoveUtils::getFromSq(move);
     int to = MoveUtils::MoveUtils::getToSq(move);
     int prom = MoveUtils::MoveUtils::getPromotionPiece(move);
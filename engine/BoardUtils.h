@@ -3,21 +3,152 @@
 #ifndef BOARDUTILS_H_
 #define BOARDUTILS_H_
 
+#include <array>
+
 #include "Board.h"
 
+// ---compile time tables---
+// the bitboard tables are generated by constexpr functions, so they are stored in read-only data
+// (shared between processes) instead of being computed every time the engine starts
+class BoardTables {
+public:
+    typedef std::array<U64, 64> SquareTable;
+
+    // rank and file steps of the 8 directions: the rook ones first, then the bishop ones
+    // direction d^1 is the opposite of direction d, and the even ones go towards higher squares
+    static constexpr int DIR_RANK[8] = {1, -1, 0, 0, 1, -1, 1, -1};
+    static constexpr int DIR_FILE[8] = {0, 0, 1, -1, 1, -1, -1, 1};
+
+    static constexpr int KNIGHT_RANK[8] = {2, 2, 1, 1, -1, -1, -2, -2}, KNIGHT_FILE[8] = {-1, 1, -2, 2, -2, 2, -1, 1};
+    static constexpr int KING_RANK[8] = {1, 1, 1, 0, 0, -1, -1, -1}, KING_FILE[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+    static constexpr int WHITE_PAWN_RANK[2] = {1, 1}, BLACK_PAWN_RANK[2] = {-1, -1}, PAWN_FILE[2] = {-1, 1};
+
+    static constexpr bool inBoard(int rank, int file) { return rank >= 0 && rank < 8 && file >= 0 && file < 8; }
+
+    // closest and farthest square of a ray going in direction d
+    static constexpr int closestSquare(U64 ray, int d) { return (d & 1 ? 63 - __builtin_clzll(ray) : __builtin_ctzll(ray)); }
+    static constexpr int farthestSquare(U64 ray, int d) { return (d & 1 ? __builtin_ctzll(ray) : 63 - __builtin_clzll(ray)); }
+
+    // squares reached by the given (rank, file) steps from every square
+    template<int N> static constexpr SquareTable stepAttacks(const int (&dr)[N], const int (&df)[N]) {
+        SquareTable t{};
+        for(int sq = 0; sq < 64; sq++)
+            for(int i = 0; i < N; i++)
+                if(inBoard((sq >> 3) + dr[i], (sq & 7) + df[i])) t[sq] |= (1ULL << (sq + 8*dr[i] + df[i]));
+        return t;
+    }
+
+    static constexpr SquareTable bits() {
+        SquareTable t{};
+        for(int i = 0; i < 64; i++) t[i] = (1ULL << i);
+        return t;
+    }
+
+    static constexpr std::array<U64, 8> lines(bool files) {
+        std::array<U64, 8> t{};
+        for(int i = 0; i < 64; i++) t[files ? (i & 7) : (i >> 3)] |= (1ULL << i);
+        return t;
+    }
+
+    static constexpr U64 squareColor(bool light) {
+        U64 bb = 0;
+        for(int i = 0; i < 64; i++)
+            if((((i & 7) + (i >> 3)) % 2 == 1) == light) bb |= (1ULL << i);
+        return bb;
+    }
+
+    // the squares a king can move to and the squares in front of his 'forward' moves
+    static constexpr SquareTable squaresNearKing(bool white) {
+        SquareTable king = stepAttacks(KING_RANK, KING_FILE), t{};
+        for(int i = 0; i < 64; i++) {
+            t[i] = (king[i] | (1ULL << i));
+            if(white && i+north < 64) t[i] |= king[i+north];
+            if(!white && i+south >= 0) t[i] |= king[i+south];
+        }
+        return t;
+    }
+
+    // squares in a direction until the edge of the board (the square itself is excluded)
+    static constexpr std::array<SquareTable, 8> rays() {
+        std::array<SquareTable, 8> t{};
+        for(int d = 0; d < 8; d++) {
+            for(int sq = 0; sq < 64; sq++) {
+                for(int r = (sq >> 3) + DIR_RANK[d], f = (sq & 7) + DIR_FILE[d]; inBoard(r, f); r += DIR_RANK[d], f += DIR_FILE[d])
+                    t[d][sq] |= (1ULL << (8*r + f));
+            }
+        }
+        return t;
+    }
+
+    // the relevant occupancy for sliders: the rays without the edge squares they end on
+    static constexpr SquareTable sliderMasks(bool bishop) {
+        std::array<SquareTable, 8> r = rays();
+        SquareTable t{};
+        for(int sq = 0; sq < 64; sq++) {
+            for(int d = (bishop ? 4 : 0); d < (bishop ? 8 : 4); d++) {
+                if(r[d][sq]) t[sq] |= (r[d][sq] ^ (1ULL << farthestSquare(r[d][sq], d)));
+            }
+        }
+        return t;
+    }
+
+    // squares strictly between two aligned squares, or the full line (edge to edge) going through them
+    // both are 0 if the squares are not on the same rank, file or diagonal
+    static constexpr std::array<SquareTable, 64> betweenOrLine(bool line) {
+        std::array<SquareTable, 8> r = rays();
+        std::array<SquareTable, 64> t{};
+        for(int sq = 0; sq < 64; sq++) {
+            for(int d = 0; d < 8; d++) {
+                U64 full = (r[d][sq] | r[d ^ 1][sq] | (1ULL << sq)), between = 0;
+                for(U64 ray = r[d][sq]; ray; ) {
+                    int to = closestSquare(ray, d);
+                    t[sq][to] = (line ? full : between);
+                    between |= (1ULL << to);
+                    ray ^= (1ULL << to);
+                }
+            }
+        }
+        return t;
+    }
+};
+
 class BoardUtils {
 public:
-    static U64 bits[64], filesBB[8], ranksBB[8], knightAttacksBB[64], kingAttacksBB[64], whitePawnAttacksBB[64], blackPawnAttacksBB[64];
-    static U64 squaresNearWhiteKing[64], squaresNearBlackKing[64];
-    static U64 lightSquaresBB, darkSquaresBB;
-    static U64 bishopMasks[64], rookMasks[64], castleMask[4];
+    static constexpr BoardTables::SquareTable bits = BoardTables::bits();
+    static constexpr std::array<U64, 8> filesBB = BoardTables::lines(true), ranksBB = BoardTables::lines(false);
+
+    static constexpr BoardTables::SquareTable knightAttacksBB = BoardTables::stepAttacks(BoardTables::KNIGHT_RANK, BoardTables::KNIGHT_FILE);
+    static constexpr BoardTables::SquareTable kingAttacksBB = BoardTables::stepAttacks(BoardTables::KING_RANK, BoardTables::KING_FILE);
+    static constexpr BoardTables::SquareTable whitePawnAttacksBB = BoardTables::stepAttacks(BoardTables::WHITE_PAWN_RANK, BoardTables::PAWN_FILE);
+    static constexpr BoardTables::SquareTable blackPawnAttacksBB = BoardTables::stepAttacks(BoardTables::BLACK_PAWN_RANK, BoardTables::PAWN_FILE);
+
+    static constexpr BoardTables::SquareTable squaresNearWhiteKing = BoardTables::squaresNearKing(true);
+    static constexpr BoardTables::SquareTable squaresNearBlackKing = BoardTables::squaresNearKing(false);
+    static constexpr U64 lightSquaresBB = BoardTables::squareColor(true), darkSquaresBB = BoardTables::squareColor(false);
+
+    // rays from every square to the edge of the board, indexed as BoardTables::DIR_RANK and DIR_FILE
+    static constexpr std::array<BoardTables::SquareTable, 8> raysBB = BoardTables::rays();
+    static constexpr BoardTables::SquareTable bishopMasks = BoardTables::sliderMasks(true), rookMasks = BoardTables::sliderMasks(false);
+
+    // bitboards for checking empty squares between king and rook when castling
+    static constexpr U64 castleMask[4] = {
+        (1ULL << f1) | (1ULL << g1),
+        (1ULL << b1) | (1ULL << c1) | (1ULL << d1),
+        (1ULL << f8) | (1ULL << g8),
+        (1ULL << b8) | (1ULL << c8) | (1ULL << d8)
+    };
+
+    static constexpr std::array<BoardTables::SquareTable, 64> betweenBB = BoardTables::betweenOrLine(false);
+    static constexpr std::array<BoardTables::SquareTable, 64> lineBB = BoardTables::betweenOrLine(true);
+
     const static int castleStartSq[4], castleEndSq[4];
 
 
-    static U64 eastOne(U64 bb);
-    static U64 westOne(U64 bb);
-    static U64 northOne(U64 bb);
-    static U64 southOne(U64 bb);
+    // functions that return the board shifted in a direction
+    inline static U64 eastOne(U64 bb) { return ((bb << 1) & (~filesBB[0])); }
+    inline static U64 westOne(U64 bb) { return ((bb >> 1) & (~filesBB[7])); }
+    inline static U64 northOne(U64 bb) { return (bb << 8); }
+    inline static U64 southOne(U64 bb) { return (bb >> 8); }
 
     static U64 pawnAttacks(U64 pawns, int color);
     static U64 knightAttacks(U64 knights);
@@ -26,7 +157,7 @@ public:
 
     static int direction(int from, int to);
     static string square(int x);
-    static string moveToString(int move);
+    static string moveToString(Move move);
 };
 
 #endif
\ No newline at end of file
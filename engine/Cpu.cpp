@@ -0,0 +1,26 @@
+#include <string>
+
+#include "Cpu.h"
+
+using namespace std;
+
+string Cpu::variant() {
+#if MULTI_ISA && defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) && !defined(__clang__)
+    // the same checks as the resolver of the clones
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("x86-64-v4")) return "x86-64-v4 (runtime dispatch)";
+    if(__builtin_cpu_supports("x86-64-v3")) return "x86-64-v3 (runtime dispatch)";
+    if(__builtin_cpu_supports("x86-64-v2")) return "x86-64-v2 (runtime dispatch)";
+    return "x86-64 (runtime dispatch)";
+#elif defined(__AVX512F__) && defined(__AVX512BW__)
+    return "x86-64-v4 (compiled)";
+#elif defined(__AVX2__) && defined(__BMI2__)
+    return "x86-64-v3 (compiled)";
+#elif defined(__POPCNT__) && defined(__SSE4_2__)
+    return "x86-64-v2 (compiled)";
+#elif defined(__x86_64__)
+    return "x86-64 (compiled)";
+#else
+    return "generic (compiled)";
+#endif
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#ifndef CPU_H_
+#define CPU_H_
+
+#include <string>
+
+// the hot routines are compiled for every x86-64 level and the best one is picked at startup if this is 1
+// (a binary that runs on any x86-64 cpu), otherwise the engine is compiled for a single target
+#ifndef MULTI_ISA
+#define MULTI_ISA 0
+#endif
+
+// gcc builds a clone of the function for every level and resolves the calls to the best one when the program is loaded
+// the inline kernels (popcount, bitscans, slider lookups, the nnue loops) are compiled again inside every clone,
+// so the entry points of the hot code are marked instead of the kernels themselves
+#if MULTI_ISA && defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) && !defined(__clang__)
+#define HOT_KERNEL __attribute__((target_clones("default", "arch=x86-64-v2", "arch=x86-64-v3", "arch=x86-64-v4")))
+// the specialised routines called by the entry points have to be inlined into the clones to be compiled for their level
+#define HOT_INLINE __attribute__((always_inline))
+#else
+#define HOT_KERNEL
+#define HOT_INLINE
+#endif
+
+// ---cpu---
+class Cpu {
+public:
+    // the instruction set the hot code runs with: the selected clone, or the target of the build
+    static std::string variant();
+};
+
+#endif
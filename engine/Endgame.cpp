@@ -0,0 +1,196 @@
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <mutex>
+
+#include "Endgame.h"
+#include "Evaluate.h"
+#include "Board.h"
+#include "MagicBitboardUtils.h"
+#include "BoardUtils.h"
+#include "Enums.h"
+
+using namespace std;
+
+const int Endgame::KNOWN_WIN = 1000;
+
+uint32_t Endgame::kpkBitbase[KPK_SIZE / 32];
+
+// the pawn is always white and on the a-d files, stm 0 -> white to move, 1 -> black to move
+int Endgame::kpkIndex(int stm, int whiteKingSq, int blackKingSq, int pawnSq) {
+    int pawnIndex = ((pawnSq >> 3) - 1) * 4 + (pawnSq & 7);
+    return stm + 2 * (blackKingSq + 64 * (whiteKingSq + 64 * pawnIndex));
+}
+
+// ---kpk bitbase---
+// every king and pawn vs king position is classified by iterating until nothing changes:
+// white wins if one of its moves wins, and black draws if one of its moves draws
+void Endgame::initKPK() {
+    const unsigned char INVALID = 0, UNKNOWN = 1, DRAW = 2, WIN = 4;
+    vector<unsigned char> db(KPK_SIZE);
+
+    for(int idx = 0; idx < KPK_SIZE; idx++) {
+        int stm = (idx & 1);
+        int bk = ((idx >> 1) & 63), wk = ((idx >> 7) & 63);
+        int pawnIndex = (idx >> 13);
+        int psq = ((pawnIndex >> 2) + 1) * 8 + (pawnIndex & 3);
+
+        U64 whiteKingAttacks = BoardUtils::kingAttacksBB[wk];
+        U64 blackKingAttacks = BoardUtils::kingAttacksBB[bk];
+        U64 pawnAttacks = BoardUtils::whitePawnAttacksBB[psq];
+
+        if(distance(wk, bk) <= 1 || wk == psq || bk == psq || (stm == 0 && (pawnAttacks & BoardUtils::bits[bk])))
+            db[idx] = INVALID;
+
+        // the pawn promotes and the queen can't be captured
+        else if(stm == 0 && (psq >> 3) == 6 && wk != psq+8 && (distance(bk, psq+8) > 1 || distance(wk, psq+8) == 1))
+            db[idx] = WIN;
+
+        // stalemate or the pawn can be captured
+        else if(stm == 1 && ((blackKingAttacks & ~(whiteKingAttacks | pawnAttacks)) == 0 || (blackKingAttacks & ~whiteKingAttacks & BoardUtils::bits[psq])))
+            db[idx] = DRAW;
+
+        else db[idx] = UNKNOWN;
+    }
+
+    bool changed = true;
+    while(changed) {
+        changed = false;
+
+        for(int idx = 0; idx < KPK_SIZE; idx++) {
+            if(db[idx] != UNKNOWN) continue;
+
+            int stm = (idx & 1);
+            int bk = ((idx >> 1) & 63), wk = ((idx >> 7) & 63);
+            int pawnIndex = (idx >> 13);
+            int psq = ((pawnIndex >> 2) + 1) * 8 + (pawnIndex & 3);
+
+            // invalid successors are 0 so they don't change the result
+            unsigned char r = 0;
+            if(stm == 0) {
+                U64 kingMoves = BoardUtils::kingAttacksBB[wk];
+                while(kingMoves) {
+                    r |= db[kpkIndex(1, MagicBitboardUtils::bitscanForward(kingMoves), bk, psq)];
+                    kingMoves &= (kingMoves-1);
+                }
+
+                if((psq >> 3) < 6) r |= db[kpkIndex(1, wk, bk, psq+8)];
+                if((psq >> 3) == 1 && psq+8 != wk && psq+8 != bk) r |= db[kpkIndex(1, wk, bk, psq+16)];
+
+                r = ((r & WIN) ? WIN : ((r & UNKNOWN) ? UNKNOWN : DRAW));
+            } else {
+                U64 kingMoves = BoardUtils::kingAttacksBB[bk];
+                while(kingMoves) {
+                    r |= db[kpkIndex(0, wk, MagicBitboardUtils::bitscanForward(kingMoves), psq)];
+                    kingMoves &= (kingMoves-1);
+                }
+
+                r = ((r & DRAW) ? DRAW : ((r & UNKNOWN) ? UNKNOWN : WIN));
+            }
+
+            if(r != UNKNOWN) {
+                db[idx] = r;
+                changed = true;
+            }
+        }
+    }
+
+    for(int idx = 0; idx < KPK_SIZE; idx++) {
+        if(db[idx] == WIN) kpkBitbase[idx >> 5] |= (1u << (idx & 31));
+    }
+}
+
+// returns true if white wins
+// the bitbase is only built the first time it is needed, so it doesn't slow down the startup
+bool Endgame::probeKPK(int stm, int whiteKingSq, int whitePawnSq, int blackKingSq) {
+    static once_flag kpkInitialized;
+    call_once(kpkInitialized, initKPK);
+
+    if((whitePawnSq & 7) >= 4) {
+        whiteKingSq ^= 7;
+        whitePawnSq ^= 7;
+        blackKingSq ^= 7;
+    }
+
+    int idx = kpkIndex(stm, whiteKingSq, blackKingSq, whitePawnSq);
+    return (kpkBitbase[idx >> 5] & (1u << (idx & 31)));
+}
+
+int Endgame::distance(int sq1, int sq2) {
+    return max(abs((sq1 & 7) - (sq2 & 7)), abs((sq1 >> 3) - (sq2 >> 3)));
+}
+
+// bonus for driving the king away from the center
+int Endgame::pushToEdge(int sq) {
+    int file = (sq & 7), rank = (sq >> 3);
+    return 20 * (max(3 - file, file - 4) + max(3 - rank, rank - 4));
+}
+
+// bonus for driving the king to a corner of the given color
+int Endgame::pushToCorner(int sq, bool darkCorners) {
+    int d = (darkCorners ? min(distance(sq, a1), distance(sq, h8)) : min(distance(sq, a8), distance(sq, h1)));
+    return 30 * (7 - d);
+}
+
+// bonus for keeping the kings close
+int Endgame::pushClose(int sq1, int sq2) {
+    return 10 * (7 - distance(sq1, sq2));
+}
+
+// mating material against a lone king (KQK, KRK, KBBK...)
+int Endgame::evaluateKXK(int strongSide) {
+    int strongKing = (strongSide == White ? board->whiteKingSquare : board->blackKingSquare);
+    int weakKing = (strongSide == White ? board->blackKingSquare : board->whiteKingSquare);
+
+    // bishops that are all on one color can't mate
+    U64 bishopsBB = board->byType[Bishop];
+    if(board->pieceCount[strongSide | Knight] + board->pieceCount[strongSide | Rook] + board->pieceCount[strongSide | Queen] == 0
+       && (!(bishopsBB & BoardUtils::lightSquaresBB) || !(bishopsBB & BoardUtils::darkSquaresBB))) return 0;
+
+    int eval = KNOWN_WIN;
+    for(int piece: {Knight, Bishop, Rook, Queen})
+        eval += board->pieceCount[strongSide | piece] * PIECE_VALUES[piece];
+
+    eval += pushToEdge(weakKing) + pushClose(strongKing, weakKing);
+    return eval;
+}
+
+// bishop and knight mate can only be delivered in a corner of the bishop's color
+int Endgame::evaluateKBNK(int strongSide) {
+    int strongKing = (strongSide == White ? board->whiteKingSquare : board->blackKingSquare);
+    int weakKing = (strongSide == White ? board->blackKingSquare : board->whiteKingSquare);
+    bool darkBishop = (board->byType[Bishop] & BoardUtils::darkSquaresBB);
+
+    int eval = KNOWN_WIN + PIECE_VALUES[Bishop] + PIECE_VALUES[Knight];
+    eval += pushToCorner(weakKing, darkBishop) + pushClose(strongKing, weakKing);
+    return eval;
+}
+
+// exact result from the bitbase, the score grows as the pawn advances
+int Endgame::evaluateKPK(int strongSide) {
+    int strongKing = (strongSide == White ? board->whiteKingSquare : board->blackKingSquare);
+    int weakKing = (strongSide == White ? board->blackKingSquare : board->whiteKingSquare);
+    int pawnSq = MagicBitboardUtils::bitscanForward(board->byType[Pawn]);
+
+    // look at the position as if the stronger side was white
+    if(strongSide == Black) {
+        strongKing ^= 56;
+        weakKing ^= 56;
+        pawnSq ^= 56;
+    }
+    int stm = (board->turn == strongSide ? 0 : 1);
+
+    if(!probeKPK(stm, strongKing, pawnSq, weakKing)) return 0;
+
+    return KNOWN_WIN + PIECE_VALUES[Pawn] + 20 * (pawnSq >> 3);
+}
+
+// the queen usually wins against the rook, but the defending king needs to be driven to the edge
+int Endgame::evaluateKQKR(int strongSide) {
+    int strongKing = (strongSide == White ? board->whiteKingSquare : board->blackKingSquare);
+    int weakKing = (strongSide == White ? board->blackKingSquare : board->whiteKingSquare);
+
+    int eval = PIECE_VALUES[Queen] - PIECE_VALUES[Rook];
+    eval += pushToEdge(weakKing) + pushClose(strongKing, weakKing);
+    return eval;
+}
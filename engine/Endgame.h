@@ -0,0 +1,35 @@
+#pragma once
+
+#ifndef ENDGAME_H_
+#define ENDGAME_H_
+
+#include <cstdint>
+
+// ---specialised endgame evaluation---
+// functions for endings where the general evaluation doesn't know how to make progress
+// they return the score from the point of view of the stronger side
+class Endgame {
+private:
+    static const int KPK_SIZE = 2 * 24 * 64 * 64;
+    static uint32_t kpkBitbase[KPK_SIZE / 32];
+
+    static int kpkIndex(int stm, int whiteKingSq, int blackKingSq, int pawnSq);
+    static bool probeKPK(int stm, int whiteKingSq, int whitePawnSq, int blackKingSq);
+
+    static int distance(int sq1, int sq2);
+    static int pushToEdge(int sq);
+    static int pushToCorner(int sq, bool darkCorners);
+    static int pushClose(int sq1, int sq2);
+
+public:
+    static const int KNOWN_WIN;
+
+    static void initKPK();
+
+    static int evaluateKXK(int strongSide);
+    static int evaluateKBNK(int strongSide);
+    static int evaluateKPK(int strongSide);
+    static int evaluateKQKR(int strongSide);
+};
+
+#endif
@@ -1,11 +1,18 @@
 #include <unordered_map>
+#include <climits>
+#include <cstdlib>
 
 #include "Evaluate.h"
 #include "Board.h"
 #include "MagicBitboardUtils.h"
 #include "TranspositionTable.h"
 #include "BoardUtils.h"
+#include "NNUE.h"
+#include "Material.h"
+#include "Search.h"
 #include "Enums.h"
+#include "Profiler.h"
+#include "Cpu.h"
 
 using namespace std;
 
@@ -173,9 +180,12 @@ int C_PAWN_PENALTY = 25;
 
 int TEMPO_BONUS = 10;
 
+// the positional terms (mobility, king safety, piece specific bonuses) are assumed to stay below this margin
+// (the largest one seen on the bench is 500cp, SEARCH_STATS builds print it)
+const int LAZY_MARGIN = 600;
+
 
 int whiteAttackersCnt, blackAttackersCnt, whiteAttackWeight, blackAttackWeight;
-int pawnCntWhite, pawnCntBlack, pieceMaterialWhite, pieceMaterialBlack;
 
 int gamePhase();
 
@@ -187,27 +197,27 @@ int evalPawn(
 );
 int evalKnight( 
     int sq, int color, 
-    int KNIGHT_TABLE[64], int& KNIGHT_MOBILITY, 
+    int& KNIGHT_MOBILITY, 
     int& KNIGHT_PAWN_CONST, int& TRAPPED_KNIGHT_PENALTY, int& BLOCKING_C_KNIGHT, int& KNIGHT_DEF_BY_PAWN,
-    int PIECE_VALUES[7], int PIECE_ATTACK_WEIGHT[6]
+    int PIECE_ATTACK_WEIGHT[6]
 );
 int evalBishop(
     int sq, int color, 
-    int BISHOP_TABLE[64], int& TRAPPED_BISHOP_PENALTY, 
+    int& TRAPPED_BISHOP_PENALTY, 
     int& BLOCKED_BISHOP_PENALTY, int& FIANCHETTO_BONUS, int& BISHOP_MOBILITY,
-    int PIECE_VALUES[7], int PIECE_ATTACK_WEIGHT[6]
+    int PIECE_ATTACK_WEIGHT[6]
 );
 int evalRook(
     int sq, int color, 
-    int ROOK_TABLE[64], int& BLOCKED_ROOK_PENALTY,
+    int& BLOCKED_ROOK_PENALTY,
     int& ROOK_PAWN_CONST, int& ROOK_ON_OPEN_FILE, int& ROOK_ON_SEVENTH, int& ROOKS_DEF_EACH_OTHER,
     int& ROOK_ON_QUEEN_FILE, int& ROOK_MOBILITY,
-    int PIECE_VALUES[7], int PIECE_ATTACK_WEIGHT[6]
+    int PIECE_ATTACK_WEIGHT[6]
 );
 int evalQueen(
     int sq, int color, 
-    int QUEEN_TABLE[64], int& EARLY_QUEEN_DEVELOPMENT,
-    int& QUEEN_MOBILITY, int PIECE_VALUES[7], int PIECE_ATTACK_WEIGHT[6]
+    int& EARLY_QUEEN_DEVELOPMENT,
+    int& QUEEN_MOBILITY, int PIECE_ATTACK_WEIGHT[6]
 );
 int evalPawnStructure(
     int MG_PAWN_TABLE[64], int EG_PAWN_TABLE[64], int PASSED_PAWN_TABLE[64],
@@ -217,7 +227,9 @@ int evalPawnStructure(
 
 int whiteKingShield(int KING_SHIELD[3]), blackKingShield(int KING_SHIELD[3]);
 
-int evaluate(
+HOT_KERNEL int evaluate(
+    int alpha, int beta,
+
     int MG_KING_TABLE[64], int EG_KING_TABLE[64],
     int QUEEN_TABLE[64], int ROOK_TABLE[64], int BISHOP_TABLE[64], 
     int KNIGHT_TABLE[64], int MG_PAWN_TABLE[64], int EG_PAWN_TABLE[64], int PASSED_PAWN_TABLE[64],
@@ -225,9 +237,9 @@ int evaluate(
     int KING_SHIELD[3], int PIECE_VALUES[7], int PIECE_ATTACK_WEIGHT[6],
 
     int& KNIGHT_MOBILITY, int& KNIGHT_PAWN_CONST, int& TRAPPED_KNIGHT_PENALTY,
-    int& KNIGHT_DEF_BY_PAWN, int& BLOCKING_C_KNIGHT, int& KNIGHT_PAIR_PENALTY, 
+    int& KNIGHT_DEF_BY_PAWN, int& BLOCKING_C_KNIGHT,
 
-    int& BISHOP_PAIR, int& TRAPPED_BISHOP_PENALTY, int& FIANCHETTO_BONUS, 
+    int& TRAPPED_BISHOP_PENALTY, int& FIANCHETTO_BONUS, 
     int& BISHOP_MOBILITY, int& BLOCKED_BISHOP_PENALTY,
 
     int& ROOK_ON_QUEEN_FILE, int& ROOK_ON_OPEN_FILE, int& ROOK_PAWN_CONST,
@@ -244,107 +256,133 @@ int evaluate(
     // reset everything
     whiteAttackersCnt = blackAttackersCnt = 0;
     whiteAttackWeight = blackAttackWeight = 0;
-    pawnCntWhite = pawnCntBlack = 0;
-    pieceMaterialWhite = pieceMaterialBlack = 0;
 
-    // evaluate pieces independently
+    Material::Entry *me = Material::probe(board);
+
+    int mgWeight = min(me->phase, 24);
+    int egWeight = 24-mgWeight;
+
+    // --- CHEAP TERMS ---
+    // material, piece square tables and the (hashed) pawn structure
     int res = 0;
+    const int PIECES[4] = {Knight, Bishop, Rook, Queen};
+    const int *TABLES[4] = {KNIGHT_TABLE, BISHOP_TABLE, ROOK_TABLE, QUEEN_TABLE};
+    const U64 PIECES_BB[4] = {board->byType[Knight], board->byType[Bishop], board->byType[Rook], board->byType[Queen]};
+    for(int i = 0; i < 4; i++) {
+        U64 pieces = PIECES_BB[i];
+
+        U64 whitePieces = (pieces & board->piecesBB(White));
+        while(whitePieces) {
+            res += PIECE_VALUES[PIECES[i]] + TABLES[i][MagicBitboardUtils::bitscanForward(whitePieces)];
+            whitePieces &= (whitePieces-1);
+        }
+
+        U64 blackPieces = (pieces & board->piecesBB(Black));
+        while(blackPieces) {
+            res -= PIECE_VALUES[PIECES[i]] + TABLES[i][FLIPPED[MagicBitboardUtils::bitscanForward(blackPieces)]];
+            blackPieces &= (blackPieces-1);
+        }
+    }
+    res += evalPawnStructure(
+        MG_PAWN_TABLE, EG_PAWN_TABLE, PASSED_PAWN_TABLE,
+        DOUBLED_PAWNS_PENALTY, WEAK_PAWN_PENALTY, C_PAWN_PENALTY,
+        PIECE_VALUES
+    );
+
+    // king centralization becomes more important than safety as pieces disappear from the board
+    int mgKingScore = MG_KING_TABLE[board->whiteKingSquare] - MG_KING_TABLE[FLIPPED[board->blackKingSquare]];
+    int egKingScore = EG_KING_TABLE[board->whiteKingSquare] - EG_KING_TABLE[FLIPPED[board->blackKingSquare]];
+
+    // tempo bonus
+    if(board->turn == White) res += TEMPO_BONUS;
+    else res -= TEMPO_BONUS;
+
+    // add scores for bishop and knight pairs
+    res += me->imbalance;
+
+    // --- LAZY EXIT ---
+    // if the cheap terms are so far outside the window that the positional terms can't bring the score back, skip them
+    int lazyScore = res + (mgWeight * mgKingScore + egWeight * egKingScore) / 24;
+    lazyScore = lazyScore * me->scale[(int)(lazyScore >= 0)] / Material::SCALE_NORMAL;
+    if(board->turn == Black) lazyScore *= -1;
+
+    // only the calls with a real window (quiescence stand pat) are counted
+    SEARCH_STAT(if(alpha != INT_MIN || beta != INT_MAX) Search::stats.lazyEvalCalls++);
+    if(lazyScore - LAZY_MARGIN >= beta || lazyScore + LAZY_MARGIN <= alpha) {
+        SEARCH_STAT(Search::stats.lazyEvalExits++);
+        return lazyScore;
+    }
+
+    // --- POSITIONAL TERMS ---
+    // mobility, piece specific bonuses and attacks on the enemy king
+    int positional = 0;
     for(int sq = 0; sq < 64; sq++) {
         if(board->squares[sq] == Empty) continue;
 
         int color = (board->squares[sq] & (Black | White));
         int c = (color == White ? 1 : -1);
 
-        if(board->knightsBB & BoardUtils::bits[sq]) res += evalKnight(
-            sq, color, KNIGHT_TABLE,
+        if(board->byType[Knight] & BoardUtils::bits[sq]) positional += evalKnight(
+            sq, color,
             KNIGHT_MOBILITY, KNIGHT_PAWN_CONST, TRAPPED_KNIGHT_PENALTY, 
-            BLOCKING_C_KNIGHT, KNIGHT_DEF_BY_PAWN, PIECE_VALUES, PIECE_ATTACK_WEIGHT) * c;
+            BLOCKING_C_KNIGHT, KNIGHT_DEF_BY_PAWN, PIECE_ATTACK_WEIGHT) * c;
 
-        if(board->bishopsBB & BoardUtils::bits[sq]) res += evalBishop(
-            sq, color, BISHOP_TABLE, 
+        if(board->byType[Bishop] & BoardUtils::bits[sq]) positional += evalBishop(
+            sq, color,
             TRAPPED_BISHOP_PENALTY, BLOCKED_BISHOP_PENALTY, 
-            FIANCHETTO_BONUS, BISHOP_MOBILITY, PIECE_VALUES, PIECE_ATTACK_WEIGHT) * c;
+            FIANCHETTO_BONUS, BISHOP_MOBILITY, PIECE_ATTACK_WEIGHT) * c;
 
-        if(board->rooksBB & BoardUtils::bits[sq]) res += evalRook(
-            sq, color, ROOK_TABLE, 
+        if(board->byType[Rook] & BoardUtils::bits[sq]) positional += evalRook(
+            sq, color,
             BLOCKED_ROOK_PENALTY,ROOK_PAWN_CONST, ROOK_ON_OPEN_FILE, 
             ROOK_ON_SEVENTH, ROOKS_DEF_EACH_OTHER, ROOK_ON_QUEEN_FILE, ROOK_MOBILITY, 
-            PIECE_VALUES, PIECE_ATTACK_WEIGHT) * c;
+            PIECE_ATTACK_WEIGHT) * c;
 
-        if(board->queensBB & BoardUtils::bits[sq]) res += evalQueen(
-            sq, color, QUEEN_TABLE, EARLY_QUEEN_DEVELOPMENT,
-            QUEEN_MOBILITY, PIECE_VALUES, PIECE_ATTACK_WEIGHT) * c;
+        if(board->byType[Queen] & BoardUtils::bits[sq]) positional += evalQueen(
+            sq, color, EARLY_QUEEN_DEVELOPMENT,
+            QUEEN_MOBILITY, PIECE_ATTACK_WEIGHT) * c;
     }
-    res += evalPawnStructure(
-        MG_PAWN_TABLE, EG_PAWN_TABLE, PASSED_PAWN_TABLE,
-        DOUBLED_PAWNS_PENALTY, WEAK_PAWN_PENALTY, C_PAWN_PENALTY,
-        PIECE_VALUES
-    );
-
-    // evaluate kings based on the current game phase (king centralization becomes more important than safety as pieces disappear from the board)
-    int mgWeight = min(gamePhase(), 24);
-    int egWeight = 24-mgWeight;
-
-    int mgKingScore = whiteKingShield(KING_SHIELD) - blackKingShield(KING_SHIELD);
-    int egKingScore = 0;
+    res += positional;
 
     // evaluate king safety in the middlegame
+    int mgSafety = whiteKingShield(KING_SHIELD) - blackKingShield(KING_SHIELD);
 
     // if only 1 or 2 attackers, we consider the king safe
     if(whiteAttackersCnt <= 2) whiteAttackWeight = 0;
     if(blackAttackersCnt <= 2) blackAttackWeight = 0;
 
-    mgKingScore += KING_SAFETY_TABLE[whiteAttackWeight] - KING_SAFETY_TABLE[blackAttackWeight];
-    mgKingScore += MG_KING_TABLE[board->whiteKingSquare] - MG_KING_TABLE[FLIPPED[board->blackKingSquare]];
-
-    egKingScore += EG_KING_TABLE[board->whiteKingSquare] - EG_KING_TABLE[FLIPPED[board->blackKingSquare]];
+    mgSafety += KING_SAFETY_TABLE[whiteAttackWeight] - KING_SAFETY_TABLE[blackAttackWeight];
+    mgKingScore += mgSafety;
 
     res += (mgWeight * mgKingScore + egWeight * egKingScore) / 24;
 
-    // tempo bonus
-    if(board->turn == White) res += TEMPO_BONUS;
-    else res -= TEMPO_BONUS;
-
-    // add scores for bishop and knight pairs
-    if(MagicBitboardUtils::popcount(board->whitePiecesBB & board->bishopsBB) >= 2) res += BISHOP_PAIR;
-    if(MagicBitboardUtils::popcount(board->blackPiecesBB & board->bishopsBB) >= 2) res -= BISHOP_PAIR;
-
-    if(MagicBitboardUtils::popcount(board->whitePiecesBB & board->knightsBB) >= 2) res -= KNIGHT_PAIR_PENALTY;
-    if(MagicBitboardUtils::popcount(board->blackPiecesBB & board->knightsBB) >= 2) res += KNIGHT_PAIR_PENALTY;
-
     // low material corrections (adjusting the score for well known draws)
+    res = res * me->scale[(int)(res >= 0)] / Material::SCALE_NORMAL;
 
-    int strongerSide = White, weakerSide = Black;
-    int strongerPawns = pawnCntWhite, weakerPawns = pawnCntBlack;
-    int strongerPieces = pieceMaterialWhite, weakerPieces = pieceMaterialBlack;
-    if(res < 0) {
-        swap(strongerSide, weakerSide);
-        swap(strongerPieces, weakerPieces);
-        swap(strongerPawns, weakerPawns);
-    }
-
-    if(strongerPawns == 0) {
-        // weaker side cannot be checkmated
-        if(strongerPieces < 400) return 0;
-        if(weakerPawns == 0 && weakerPieces == 2*PIECE_VALUES[Knight]) return 0;
-
-        // rook vs minor piece
-        if(strongerPieces == PIECE_VALUES[Rook] && (weakerPieces == PIECE_VALUES[Knight] || weakerPieces == PIECE_VALUES[Bishop]) )
-            res /= 2;
-
-        // rook and minor vs rook
-        if((strongerPieces == PIECE_VALUES[Rook] + PIECE_VALUES[Bishop] || strongerPieces == PIECE_VALUES[Rook] + PIECE_VALUES[Knight])
-           && weakerPieces == PIECE_VALUES[Rook])
-            res /= 2;
-    }
     // return result from the perspective of the side to move
     if(board->turn == Black) res *= -1;
 
+    // keep track of the largest contribution of the skipped terms, so that the margin can be checked
+    SEARCH_STAT(Search::stats.maxPositionalScore = max(Search::stats.maxPositionalScore, abs(res - lazyScore)));
+
     return res;
 }
 
-int evaluate() {
+int evaluate(int alpha, int beta) {
+    PROFILE_SCOPE(PROFILE_EVALUATE);
+
+    // known endgames have their own evaluation functions
+    Material::Entry *me = Material::probe(board);
+    if(me->endgame != nullptr) {
+        int score = me->endgame(me->strongSide);
+        return (board->turn == me->strongSide ? score : -score);
+    }
+
+    if(NNUE::isActive()) return NNUE::evaluate(board, board->accumulatorStk[board->accumulatorIndex]);
+
     return evaluate(
+        alpha, beta,
+
         MG_KING_TABLE, EG_KING_TABLE,
         QUEEN_TABLE, ROOK_TABLE, BISHOP_TABLE, 
         KNIGHT_TABLE, MG_PAWN_TABLE, EG_PAWN_TABLE, PASSED_PAWN_TABLE,
@@ -352,9 +390,9 @@ int evaluate() {
         KING_SHIELD, PIECE_VALUES, PIECE_ATTACK_WEIGHT,
 
         KNIGHT_MOBILITY, KNIGHT_PAWN_CONST, TRAPPED_KNIGHT_PENALTY,
-        KNIGHT_DEF_BY_PAWN, BLOCKING_C_KNIGHT, KNIGHT_PAIR_PENALTY, 
+        KNIGHT_DEF_BY_PAWN, BLOCKING_C_KNIGHT,
 
-        BISHOP_PAIR, TRAPPED_BISHOP_PENALTY, FIANCHETTO_BONUS, 
+        TRAPPED_BISHOP_PENALTY, FIANCHETTO_BONUS, 
         BISHOP_MOBILITY, BLOCKED_BISHOP_PENALTY,
 
         ROOK_ON_QUEEN_FILE, ROOK_ON_OPEN_FILE, ROOK_PAWN_CONST, ROOK_ON_SEVENTH, 
@@ -367,24 +405,25 @@ int evaluate() {
         TEMPO_BONUS);
 }
 
-int evalKnight( 
+// full evaluation, without the lazy exit
+int evaluate() {
+    return evaluate(INT_MIN, INT_MAX);
+}
+
+HOT_KERNEL int evalKnight( 
     int sq, int color, 
-    int KNIGHT_TABLE[64], int& KNIGHT_MOBILITY, 
+    int& KNIGHT_MOBILITY, 
     int& KNIGHT_PAWN_CONST, int& TRAPPED_KNIGHT_PENALTY, int& BLOCKING_C_KNIGHT, int& KNIGHT_DEF_BY_PAWN,
-    int PIECE_VALUES[7], int PIECE_ATTACK_WEIGHT[6]
+    int PIECE_ATTACK_WEIGHT[6]
 ) {
-    U64 opponentPawnsBB = (board->pawnsBB & (color == White ? board->blackPiecesBB : board->whitePiecesBB));
-    U64 ourPawnsBB = (board->pawnsBB ^ opponentPawnsBB);
-    U64 ourPiecesBB = (color == White ? board->whitePiecesBB : board->blackPiecesBB);
+    U64 opponentPawnsBB = (board->byType[Pawn] & board->piecesBB(color ^ 8));
+    U64 ourPawnsBB = (board->byType[Pawn] ^ opponentPawnsBB);
+    U64 ourPiecesBB = board->piecesBB(color);
 
     U64 ourPawnAttacksBB = BoardUtils::pawnAttacks(ourPawnsBB, color);
     U64 opponentPawnAttacksBB = BoardUtils::pawnAttacks(opponentPawnsBB, (color ^ (White | Black)));
 
-    if(color == White) pieceMaterialWhite += PIECE_VALUES[Knight];
-    else pieceMaterialBlack += PIECE_VALUES[Knight];
-
-    // initial piece value and square value
-    int eval = PIECE_VALUES[Knight] + KNIGHT_TABLE[(color == White ? sq : FLIPPED[sq])];
+    int eval = 0;
 
 
     // mobility bonus
@@ -392,7 +431,7 @@ int evalKnight(
     eval += KNIGHT_MOBILITY * (MagicBitboardUtils::popcount(mob) - 4);
 
     // decreasing value as pawns disappear
-    int numberOfPawns = MagicBitboardUtils::popcount(board->pawnsBB);
+    int numberOfPawns = MagicBitboardUtils::popcount(board->byType[Pawn]);
     eval += KNIGHT_PAWN_CONST * (numberOfPawns - 8);
 
     // traps and blockages
@@ -446,25 +485,21 @@ int evalKnight(
     return eval;
 }
 
-int evalBishop(
+HOT_KERNEL int evalBishop(
     int sq, int color, 
-    int BISHOP_TABLE[64], int& TRAPPED_BISHOP_PENALTY, 
+    int& TRAPPED_BISHOP_PENALTY, 
     int& BLOCKED_BISHOP_PENALTY, int& FIANCHETTO_BONUS, int& BISHOP_MOBILITY,
-    int PIECE_VALUES[7], int PIECE_ATTACK_WEIGHT[6]
+    int PIECE_ATTACK_WEIGHT[6]
 ) {
-    U64 ourPawnsBB = (board->whitePiecesBB & board->pawnsBB);
-    U64 opponentPawnsBB = (board->blackPiecesBB & board->pawnsBB);
+    U64 ourPawnsBB = (board->piecesBB(White) & board->byType[Pawn]);
+    U64 opponentPawnsBB = (board->piecesBB(Black) & board->byType[Pawn]);
     if(color == Black) swap(ourPawnsBB, opponentPawnsBB);
 
     U64 opponentPawnAttacksBB = BoardUtils::pawnAttacks(opponentPawnsBB, (color ^ (White | Black)));
 
-    U64 ourPiecesBB = (color == White ? board->whitePiecesBB : board->blackPiecesBB);
+    U64 ourPiecesBB = board->piecesBB(color);
 
-    if(color == White) pieceMaterialWhite += PIECE_VALUES[Bishop];
-    else pieceMaterialBlack += PIECE_VALUES[Bishop];
-
-    // initial piece value and square value
-    int eval = PIECE_VALUES[Bishop] + BISHOP_TABLE[(color == White ? sq : FLIPPED[sq])];
+    int eval = 0;
 
     // traps and blockages
     if(color == White) {
@@ -498,7 +533,7 @@ int evalBishop(
 
     // mobility and attacks
     U64 sqNearKing = (color == White ? BoardUtils::squaresNearBlackKing[board->blackKingSquare] : BoardUtils::squaresNearWhiteKing[board->whiteKingSquare]);
-    U64 attacks = MagicBitboardUtils::magicBishopAttacks((board->whitePiecesBB | board->blackPiecesBB), sq);
+    U64 attacks = MagicBitboardUtils::magicBishopAttacks(board->occupiedBB(), sq);
 
     int mobility = MagicBitboardUtils::popcount(attacks & ~ourPiecesBB & ~opponentPawnAttacksBB);
     int attackedSquares = MagicBitboardUtils::popcount(attacks & sqNearKing);
@@ -517,20 +552,20 @@ int evalBishop(
     return eval;
 }
 
-int evalRook(
+HOT_KERNEL int evalRook(
     int sq, int color, 
-    int ROOK_TABLE[64], int& BLOCKED_ROOK_PENALTY,
+    int& BLOCKED_ROOK_PENALTY,
     int& ROOK_PAWN_CONST, int& ROOK_ON_OPEN_FILE, int& ROOK_ON_SEVENTH, int& ROOKS_DEF_EACH_OTHER,
     int& ROOK_ON_QUEEN_FILE, int& ROOK_MOBILITY,
-    int PIECE_VALUES[7], int PIECE_ATTACK_WEIGHT[6]
+    int PIECE_ATTACK_WEIGHT[6]
 ) {
     U64 currFileBB = BoardUtils::filesBB[sq%8];
     U64 currRankBB = BoardUtils::BoardUtils::ranksBB[sq/8];
 
-    U64 ourPiecesBB = (color == White ? board->whitePiecesBB : board->blackPiecesBB);
-    U64 opponentPiecesBB = (color == Black ? board->whitePiecesBB : board->blackPiecesBB);
-    U64 ourPawnsBB = (board->whitePiecesBB & board->pawnsBB);
-    U64 opponentPawnsBB = (board->blackPiecesBB & board->pawnsBB);
+    U64 ourPiecesBB = board->piecesBB(color);
+    U64 opponentPiecesBB = board->piecesBB(color ^ 8);
+    U64 ourPawnsBB = (board->piecesBB(White) & board->byType[Pawn]);
+    U64 opponentPawnsBB = (board->piecesBB(Black) & board->byType[Pawn]);
     if(color == Black) swap(ourPawnsBB, opponentPawnsBB);
 
     U64 opponentPawnAttacksBB = BoardUtils::pawnAttacks(opponentPawnsBB, (color ^ (White | Black)));
@@ -541,11 +576,7 @@ int evalRook(
     int seventhRank = (color == White ? 6 : 1);
     int eighthRank = (color == White ? 7 : 0);
 
-    if(color == White) pieceMaterialWhite += PIECE_VALUES[Rook];
-    else pieceMaterialBlack += PIECE_VALUES[Rook];
-
-    // initial piece value and square value
-    int eval = PIECE_VALUES[Rook] + ROOK_TABLE[(color == White ? sq : FLIPPED[sq])];
+    int eval = 0;
 
     // blocked by uncastled king
     if(color == White) {
@@ -562,7 +593,7 @@ int evalRook(
     }
 
     // the rook becomes more valuable as there are less pawns on the board
-    int numberOfPawns = MagicBitboardUtils::popcount(board->pawnsBB);
+    int numberOfPawns = MagicBitboardUtils::popcount(board->byType[Pawn]);
     eval += ROOK_PAWN_CONST * (8 - numberOfPawns);
 
     // bonus for a rook on an open or semi open file
@@ -579,15 +610,15 @@ int evalRook(
         eval += ROOK_ON_SEVENTH;
 
     // small bonus if the rook is defended by another rook
-    if((board->rooksBB & ourPiecesBB & (currRankBB | currFileBB)) ^ BoardUtils::bits[sq])
+    if((board->byType[Rook] & ourPiecesBB & (currRankBB | currFileBB)) ^ BoardUtils::bits[sq])
         eval += ROOKS_DEF_EACH_OTHER;
 
     // bonus for a rook that is on the same file as the enemy queen
-    if(currFileBB & opponentPiecesBB & board->queensBB) eval += ROOK_ON_QUEEN_FILE;
+    if(currFileBB & opponentPiecesBB & board->byType[Queen]) eval += ROOK_ON_QUEEN_FILE;
 
     // mobility and attacks
     U64 sqNearKing = (color == White ? BoardUtils::squaresNearBlackKing[board->blackKingSquare] : BoardUtils::squaresNearWhiteKing[board->whiteKingSquare]);
-    U64 attacks = MagicBitboardUtils::magicRookAttacks((board->whitePiecesBB | board->blackPiecesBB), sq);
+    U64 attacks = MagicBitboardUtils::magicRookAttacks(board->occupiedBB(), sq);
 
     int mobility = MagicBitboardUtils::popcount(attacks & ~ourPiecesBB & ~opponentPawnAttacksBB);
     int attackedSquares = MagicBitboardUtils::popcount(attacks & sqNearKing);
@@ -606,24 +637,20 @@ int evalRook(
     return eval;
 }
 
-int evalQueen(
+HOT_KERNEL int evalQueen(
     int sq, int color, 
-    int QUEEN_TABLE[64], int& EARLY_QUEEN_DEVELOPMENT, int& QUEEN_MOBILITY,
-    int PIECE_VALUES[7], int PIECE_ATTACK_WEIGHT[6]
+    int& EARLY_QUEEN_DEVELOPMENT, int& QUEEN_MOBILITY,
+    int PIECE_ATTACK_WEIGHT[6]
 ) {
-    U64 ourPiecesBB = (color == White ? board->whitePiecesBB : board->blackPiecesBB);
-    U64 opponentPiecesBB = (color == Black ? board->whitePiecesBB : board->blackPiecesBB);
-    U64 ourBishopsBB = (board->bishopsBB & ourPiecesBB);
-    U64 ourKnightsBB = (board->knightsBB & ourPiecesBB);
+    U64 ourPiecesBB = board->piecesBB(color);
+    U64 opponentPiecesBB = board->piecesBB(color ^ 8);
+    U64 ourBishopsBB = (board->byType[Bishop] & ourPiecesBB);
+    U64 ourKnightsBB = (board->byType[Knight] & ourPiecesBB);
 
-    U64 opponentPawnsBB = (board->pawnsBB & opponentPiecesBB);
+    U64 opponentPawnsBB = (board->byType[Pawn] & opponentPiecesBB);
     U64 opponentPawnAttacksBB = BoardUtils::pawnAttacks(opponentPawnsBB, (color ^ (White | Black)));
 
-    if(color == White) pieceMaterialWhite += PIECE_VALUES[Queen];
-    else pieceMaterialBlack += PIECE_VALUES[Queen];
-
-    // initial piece value and square value
-    int eval = PIECE_VALUES[Queen] + QUEEN_TABLE[(color == White ? sq : FLIPPED[sq])];
+    int eval = 0;
 
     // penalty for early development
     if(color == White && sq/8 > 1) {
@@ -641,8 +668,8 @@ int evalQueen(
 
     // mobility and attacks
     U64 sqNearKing = (color == White ? BoardUtils::squaresNearBlackKing[board->blackKingSquare] : BoardUtils::squaresNearWhiteKing[board->whiteKingSquare]);
-    U64 attacks = (MagicBitboardUtils::magicBishopAttacks((board->whitePiecesBB | board->blackPiecesBB), sq)
-                 | MagicBitboardUtils::magicRookAttacks((board->whitePiecesBB | board->blackPiecesBB), sq));
+    U64 attacks = (MagicBitboardUtils::magicBishopAttacks(board->occupiedBB(), sq)
+                 | MagicBitboardUtils::magicRookAttacks(board->occupiedBB(), sq));
 
     int mobility = MagicBitboardUtils::popcount(attacks & ~ourPiecesBB & ~opponentPawnAttacksBB);
     int attackedSquares = MagicBitboardUtils::popcount(attacks & sqNearKing);
@@ -661,7 +688,7 @@ int evalQueen(
 }
 
 int whiteKingShield(int KING_SHIELD[3]) {
-    U64 ourPawnsBB = (board->whitePiecesBB & board->pawnsBB);
+    U64 ourPawnsBB = (board->piecesBB(White) & board->byType[Pawn]);
     int sq = board->whiteKingSquare;
 
     int eval = 0;
@@ -698,7 +725,7 @@ int whiteKingShield(int KING_SHIELD[3]) {
 }
 
 int blackKingShield(int KING_SHIELD[3]) {
-    U64 ourPawnsBB = (board->blackPiecesBB & board->pawnsBB);
+    U64 ourPawnsBB = (board->piecesBB(Black) & board->byType[Pawn]);
     int sq = board->blackKingSquare;
 
     int eval = 0;
@@ -735,13 +762,13 @@ int blackKingShield(int KING_SHIELD[3]) {
 }
 
 // evaluate every pawn independently but store the full pawn structure evaluation in the hash map
-int evalPawnStructure(
+HOT_KERNEL int evalPawnStructure(
     int MG_PAWN_TABLE[64], int EG_PAWN_TABLE[64], int PASSED_PAWN_TABLE[64],
     int& DOUBLED_PAWNS_PENALTY, int& WEAK_PAWN_PENALTY, int& C_PAWN_PENALTY,
     int PIECE_VALUES[7]
 ) {
-    U64 whitePawns = (board->pawnsBB & board->whitePiecesBB);
-    U64 blackPawns = (board->pawnsBB & board->blackPiecesBB);
+    U64 whitePawns = (board->byType[Pawn] & board->piecesBB(White));
+    U64 blackPawns = (board->byType[Pawn] & board->piecesBB(Black));
 
     int eval = 0;
     while(whitePawns) {
@@ -762,25 +789,22 @@ int evalPawnStructure(
     return eval;
 }
 
-int evalPawn(
+HOT_KERNEL int evalPawn(
     int sq, int color, 
     int MG_PAWN_TABLE[64], int EG_PAWN_TABLE[64], int PASSED_PAWN_TABLE[64],
     int& DOUBLED_PAWNS_PENALTY, int& WEAK_PAWN_PENALTY, int& C_PAWN_PENALTY,
     int PIECE_VALUES[7]
 ) {
-    U64 ourPiecesBB = (color == White ? board->whitePiecesBB : board->blackPiecesBB);
+    U64 ourPiecesBB = board->piecesBB(color);
 
-    U64 opponentPawnsBB = (board->pawnsBB & (color == White ? board->blackPiecesBB : board->whitePiecesBB));
-    U64 ourPawnsBB = (board->pawnsBB & (color == White ? board->whitePiecesBB : board->blackPiecesBB));
+    U64 opponentPawnsBB = (board->byType[Pawn] & board->piecesBB(color ^ 8));
+    U64 ourPawnsBB = (board->byType[Pawn] & board->piecesBB(color));
 
     U64 opponentPawnAttacksBB = BoardUtils::pawnAttacks(opponentPawnsBB, (color == White ? Black : White));
     U64 ourPawnAttacksBB = BoardUtils::pawnAttacks(ourPawnsBB, color);
 
     bool weak = true, passed = true, opposed = false;
 
-    if(color == White) pawnCntWhite ++;
-    else pawnCntBlack ++;
-
     // initial pawn value + square value
     int mgWeight = min(gamePhase(), 24);
     int egWeight = 24-mgWeight;
@@ -795,7 +819,7 @@ int evalPawn(
     // check squares in front of the pawn to see if it is passed or opposed/doubled
     int curSq = sq+dir;
     while(curSq < 64 && curSq >= 0) {
-        if(board->pawnsBB & BoardUtils::bits[curSq]) {
+        if(board->byType[Pawn] & BoardUtils::bits[curSq]) {
             passed = false;
             if(ourPiecesBB & BoardUtils::bits[curSq]) eval -= DOUBLED_PAWNS_PENALTY;
             else opposed = true;
@@ -842,8 +866,5 @@ int evalPawn(
 }
 
 int gamePhase() {
-    return MagicBitboardUtils::popcount(board->knightsBB) * MG_WEIGHT[Knight] 
-         + MagicBitboardUtils::popcount(board->bishopsBB) * MG_WEIGHT[Bishop] 
-         + MagicBitboardUtils::popcount(board->rooksBB) * MG_WEIGHT[Rook]
-         + MagicBitboardUtils::popcount(board->queensBB) * MG_WEIGHT[Queen]; 
+    return Material::probe(board)->phase;
 }
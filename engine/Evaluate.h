@@ -6,14 +6,16 @@
 #include "Board.h"
 
 extern int PIECE_VALUES[7];
+extern int BISHOP_PAIR, KNIGHT_PAIR_PENALTY;
 extern const int MG_WEIGHT[7];
 extern const int FLIPPED[64];
 
 int gamePhase();
 int evaluate();
+int evaluate(int alpha, int beta);
 
 int evaluate(
-    bool usePawnHash, 
+    int alpha, int beta,
 
     int MG_KING_TABLE[64], int EG_KING_TABLE[64],
     int QUEEN_TABLE[64], int ROOK_TABLE[64], int BISHOP_TABLE[64], 
@@ -22,9 +24,9 @@ int evaluate(
     int KING_SHIELD[3], int PIECE_VALUES[7], int PIECE_ATTACK_WEIGHT[6],
 
     int& KNGIHT_MOBILITY, int& KNIGHT_PAWN_CONST, int& TRAPPED_KNIGHT_PENALTY,
-    int& KNIGHT_DEF_BY_PAWN, int& BLOCKING_C_KNIGHT, int& KNIGHT_PAIR_PENALTY, 
+    int& KNIGHT_DEF_BY_PAWN, int& BLOCKING_C_KNIGHT,
 
-    int& BISHOP_PAIR, int& TRAPPED_BISHOP_PENALTY, int& FIANCHETTO_BONUS, 
+    int& TRAPPED_BISHOP_PENALTY, int& FIANCHETTO_BONUS, 
     int& BISHOP_MOBILITY, int& BLOCKED_BISHOP_PENALTY,
 
     int& ROOK_ON_QUEEN_FILE, int& ROOK_ON_OPEN_FILE, int& ROOK_PAWN_CONST,
@@ -5,6 +5,11 @@
 
 #include <iostream>
 #include <unordered_map>
+#include <cassert>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#endif
 
 using namespace std;
 
@@ -12,8 +17,10 @@ using namespace std;
 #include "MagicBitboardUtils.h"
 #include "BoardUtils.h"
 
+bool MagicBitboardUtils::usePext = false;
+
 // number of bits we need to shift when computing magic attacks
-const int MagicBitboardUtils::ROOK_BITS[64] = {
+constexpr int MagicBitboardUtils::ROOK_BITS[64] = {
     12, 11, 11, 11, 11, 11, 11, 12,
     11, 10, 10, 10, 10, 10, 10, 11,
     11, 10, 10, 10, 10, 10, 10, 11,
@@ -24,7 +31,7 @@ const int MagicBitboardUtils::ROOK_BITS[64] = {
     12, 11, 11, 11, 11, 11, 11, 12
 };
 
-const int MagicBitboardUtils::BISHOP_BITS[64] = {
+constexpr int MagicBitboardUtils::BISHOP_BITS[64] = {
     6, 5, 5, 5, 5, 5, 5, 6,
     5, 5, 5, 5, 5, 5, 5, 5,
     5, 5, 7, 7, 7, 7, 5, 5,
@@ -36,7 +43,7 @@ const int MagicBitboardUtils::BISHOP_BITS[64] = {
 };
 
 // precalculated values for the magic numbers
-C64 MagicBitboardUtils::BISHOP_MAGICS[64] = {577322812503966336, 2270049134510085, 38289964190400650, 158769899958174800, 565217696222208, 581529844573028484, 4036387455024235520,
+constexpr U64 MagicBitboardUtils::BISHOP_MAGICS[64] = {577322812503966336, 2270049134510085, 38289964190400650, 158769899958174800, 565217696222208, 581529844573028484, 4036387455024235520,
 581034909873737735, 1152926211925100032, 7219360397122405076, 18594945514614800, 4677221482548, 2379030914224099330, 75437566601986049, 2017614866464133392,
 37154838677037057, 361415798805365248, 55204288533234706, 288793602392342658, 18577365878833152, 295003440814227600, 18084775848838144, 584343159787553905,
 149182288558164096, 2490543513319768324, 1227530799180683298, 2534383697937920, 38289393498325024, 4521260549685264, 4613953211559199244, 36310560044222516,
@@ -46,7 +53,7 @@ C64 MagicBitboardUtils::BISHOP_MAGICS[64] = {577322812503966336, 227004913451008
 2328363309472161793, 74768267218944, 2891311257527783936, 1163617970535338272, 4613937844619182592, 90423983978136576, 1139163907769376, 638954298933377,
 306262375445569664};
 
-C64 MagicBitboardUtils::ROOK_MAGICS[64] = {72075324745056513, 18031991769276424, 648553543602538512, 4827894603405330436, 144117387368072224, 144117387233591696, 2377936887437328532,
+constexpr U64 MagicBitboardUtils::ROOK_MAGICS[64] = {72075324745056513, 18031991769276424, 648553543602538512, 4827894603405330436, 144117387368072224, 144117387233591696, 2377936887437328532,
 3494804722568675456, 1688988448522752, 216243426004312064, 281754151682064, 2814784664895556, 18295890951276546, 281483701125376, 148900271274131524,
 2306405960794767490, 35734136307724, 36312471564320848, 580964902097657859, 630513843974439168, 38280872784560640, 36592296770143232, 39582452248648,
 2253998845403220, 180144269636411392, 306280513088260352, 1153506741147664640, 36288179474432, 378311169088161024, 5911288043798594, 1297599651226584065,
@@ -63,12 +70,7 @@ const int MagicBitboardUtils::BitTable[64] = {
     58, 20, 37, 17, 36, 8
 };
 
-U64 MagicBitboardUtils::mBishopAttacks[64][512], MagicBitboardUtils::mRookAttacks[64][4096];
-
-// index of least significant set bit
-int MagicBitboardUtils::bitscanForward(U64 bb) {
-    return __builtin_ctzll(bb);
-}
+const U64 *MagicBitboardUtils::mBishopAttacks[64], *MagicBitboardUtils::mRookAttacks[64];
 
 // combine 4 random 16bit numbers
 U64 MagicBitboardUtils::randomULL() {
@@ -84,11 +86,6 @@ U64 MagicBitboardUtils::randomU64FewBits() {
     return (randomULL() & randomULL() & randomULL());
 }
 
-// number of set bits
-int MagicBitboardUtils::popcount(U64 bb) {
-    return __builtin_popcountll(bb);
-}
-
 // pop the ms1b fron a number
 int MagicBitboardUtils::popFirstBit(U64 *bb) {
     U64 b = *bb ^ (*bb - 1);
@@ -108,77 +105,70 @@ U64 MagicBitboardUtils::indexToU64(int index, int bits, U64 m) {
   return res;
 }
 
-// manually calculated rook attacks
-// we go in every direction until we find another piece
-U64 MagicBitboardUtils::rookAttacks(int sq, U64 blockers) {
+// sliding attacks computed with the rays
+// every ray is cut at the first blocker, by removing the ray that starts from it
+U64 MagicBitboardUtils::slidingAttacks(int sq, U64 blockers, bool bishop) {
     U64 res = 0;
-    int Rank = sq/8, File = sq%8;
-    for(int r = Rank+1; r <= 7; r++) {
-        res |= (1ULL << (File + r*8));
-        if(blockers & (1ULL << (File + r*8))) break;
-    }
-    for(int r = Rank-1; r >= 0; r--) {
-        res |= (1ULL << (File + r*8));
-        if(blockers & (1ULL << (File + r*8))) break;
-    }
-    for(int f = File+1; f <= 7; f++) {
-        res |= (1ULL << (f + Rank*8));
-        if(blockers & (1ULL << (f + Rank*8))) break;
-    }
-    for(int f = File-1; f >= 0; f--) {
-        res |= (1ULL << (f + Rank*8));
-        if(blockers & (1ULL << (f + Rank*8))) break;
+    for(int d = (bishop ? 4 : 0); d < (bishop ? 8 : 4); d++) {
+        U64 ray = BoardUtils::raysBB[d][sq];
+        if(ray & blockers) ray ^= BoardUtils::raysBB[d][BoardTables::closestSquare(ray & blockers, d)];
+        res |= ray;
     }
     return res;
 }
 
-// manually calculated bishop attacks
-U64 MagicBitboardUtils::bishopAttacks(int sq, U64 blockers) {
+// index of the blockers in the pext table, computed bit by bit
+constexpr U64 MagicBitboardUtils::pextIndex(U64 blockers, U64 mask) {
     U64 res = 0;
-    int Rank = sq/8, File = sq%8;
-    for(int r = Rank+1, f = File+1; r <= 7 && f <= 7; r++, f++) {
-        res |= (1ULL << (f + r*8));
-        if(blockers & (1ULL << (f + r * 8))) break;
-    }
-    for(int r = Rank+1, f = File-1; r <= 7 && f >= 0; r++, f--) {
-        res |= (1ULL << (f + r*8));
-        if(blockers & (1ULL << (f + r * 8))) break;
-    }
-    for(int r = Rank-1, f = File+1; r >= 0 && f <= 7; r--, f++) {
-        res |= (1ULL << (f + r*8));
-        if(blockers & (1ULL << (f + r * 8))) break;
-    }
-    for(int r = Rank-1, f = File-1; r >= 0 && f >= 0; r--, f--) {
-        res |= (1ULL << (f + r*8));
-        if(blockers & (1ULL << (f + r * 8))) break;
-    }
+    for(; blockers; blockers &= (blockers-1))
+        res |= (1ULL << __builtin_popcountll(mask & ((blockers & -blockers) - 1)));
     return res;
 }
 
-// populate the mBishopAttacks and mRookAttacks arrays with the correct attack bitboards 
-// according to the current magic numbers
-void MagicBitboardUtils::populateSlidingAttacks(int sq, int m, bool bishop) {
-    U64 magic = (bishop ? BISHOP_MAGICS[sq] : ROOK_MAGICS[sq]);
-    U64 mask = (bishop ? BoardUtils::bishopMasks[sq] : BoardUtils::rookMasks[sq]);
-    int n = popcount(mask);
-    U64 blockers[4096], a[4096], used[4096];
+// fill the attack table of a backend for every subset of the masks
+// the blockers on each of the 4 rays are enumerated separately, since the attacks are the union of the attacks on every ray
+// the rays are disjoint, so both the pext index and the magic product are sums of the values on every ray
+// (different blockers can share a magic index only if they have the same attacks)
+constexpr std::array<U64, MagicBitboardUtils::ATTACK_TABLE_SIZE> MagicBitboardUtils::generateAttackTable(bool pext) {
+    std::array<U64, ATTACK_TABLE_SIZE> t{};
+    int offset = 0;
+    for(int sq = 0; sq < 64; sq++) {
+        for(int bishop = 0; bishop < 2; bishop++) {
+            U64 mask = (bishop ? BoardUtils::bishopMasks[sq] : BoardUtils::rookMasks[sq]);
+            U64 magic = (bishop ? BISHOP_MAGICS[sq] : ROOK_MAGICS[sq]);
+            int m = (bishop ? BISHOP_BITS[sq] : ROOK_BITS[sq]);
+
+            U64 attacks[4][64] = {}, index[4][64] = {};
+            int cnt[4] = {};
+            for(int k = 0; k < 4; k++) {
+                int d = k + (bishop ? 4 : 0);
+                U64 ray = BoardUtils::raysBB[d][sq], rayMask = (ray & mask), blockers = 0;
+                do {
+                    attacks[k][cnt[k]] = (blockers ? ray ^ BoardUtils::raysBB[d][BoardTables::closestSquare(blockers, d)] : ray);
+                    index[k][cnt[k]] = (pext ? pextIndex(blockers, mask) : blockers * magic);
+                    cnt[k]++;
+                    blockers = ((blockers - rayMask) & rayMask);
+                } while(blockers);
+            }
 
-    for(int i = 0; i < (1 << n); i++) {
-        blockers[i] = indexToU64(i, n, mask);
-        a[i] = (bishop ? bishopAttacks(sq, blockers[i]) : rookAttacks(sq, blockers[i]));
-    }
+            for(int a = 0; a < cnt[0]; a++)
+                for(int b = 0; b < cnt[1]; b++)
+                    for(int c = 0; c < cnt[2]; c++)
+                        for(int e = 0; e < cnt[3]; e++) {
+                            U64 i = index[0][a] + index[1][b] + index[2][c] + index[3][e];
+                            t[offset + (pext ? i : (i >> (64 - m)))] = (attacks[0][a] | attacks[1][b] | attacks[2][c] | attacks[3][e]);
+                        }
 
-    for(int i = 0; i < 4096; i++) used[i] = 0;
-    for(int i = 0; i < (1 << n); i++) {
-        U64 j = ((blockers[i] * magic) >> (64 - m));
-        if(used[j] == 0) used[j] = a[i];
-    }
-    for(int i = 0; i < (1 << n); i++) {
-        if(bishop) mBishopAttacks[sq][i] = used[i];
-        else mRookAttacks[sq][i] = used[i];
+            offset += (1 << m);
+        }
     }
+    return t;
 }
 
+// each table is a separate constant expression, which keeps them under the compiler's evaluation limit
+constexpr std::array<U64, MagicBitboardUtils::ATTACK_TABLE_SIZE> MagicBitboardUtils::pextAttackTable = MagicBitboardUtils::generateAttackTable(true);
+constexpr std::array<U64, MagicBitboardUtils::ATTACK_TABLE_SIZE> MagicBitboardUtils::magicAttackTable = MagicBitboardUtils::generateAttackTable(false);
+
 // function that finds good magic numbers, using trial and error
 // it is too slow so I don't use it every time the engine starts
 // I used it once and copied the magic numbers into the arrays
@@ -190,7 +180,7 @@ U64 MagicBitboardUtils::findMagic(int sq, int m, int bishop) {
 
     for(int i = 0; i < (1 << n); i++) {
         blockers[i] = indexToU64(i, n, mask);
-        a[i] = (bishop ? bishopAttacks(sq, blockers[i]) : rookAttacks(sq, blockers[i]));
+        a[i] = slidingAttacks(sq, blockers[i], bishop);
     }
 
     bool fail;
@@ -205,14 +195,7 @@ U64 MagicBitboardUtils::findMagic(int sq, int m, int bishop) {
             if(used[j] == 0) used[j] = a[i];
             else if(used[j] != a[i]) fail = true;
         }
-        if(!fail) {
-            for(int i = 0; i < (1 << n); i++) {
-                if(bishop) mBishopAttacks[sq][i] = used[i];
-                else mRookAttacks[sq][i] = used[i];
-            }
-
-            return magic;
-        }
+        if(!fail) return magic;
     }
 
     cout << "Magic Number not found\n";
@@ -222,26 +205,48 @@ U64 MagicBitboardUtils::findMagic(int sq, int m, int bishop) {
 // the actual functions that return the attack bitboards
 // we first & the occupancy bb with the correct mask, so we only get the blockers in the attack directions
 // after that, we multiply the result with the corresponding magic number and then we right shift it
-U64 MagicBitboardUtils::magicBishopAttacks(U64 occ, int sq) {
-    occ &= BoardUtils::bishopMasks[sq];
-    occ *= BISHOP_MAGICS[sq];
-    occ >>= 64-BISHOP_BITS[sq];
-    return mBishopAttacks[sq][occ];
+// the function we will call when initializing the engine
+// checks for bmi2 with cpuid
+// amd cpus before zen 3 implement pext in microcode (hundreds of cycles), so magics are faster there
+bool MagicBitboardUtils::cpuHasFastPext() {
+#if defined(__x86_64__) && defined(__GNUC__)
+    unsigned int eax, ebx, ecx, edx;
+    if(!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & (1 << 8))) return false;
+
+    __get_cpuid(0, &eax, &ebx, &ecx, &edx);
+    bool amd = (ebx == 0x68747541 && edx == 0x69746e65 && ecx == 0x444d4163); // "AuthenticAMD"
+
+    __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+    int family = ((eax >> 8) & 0xF);
+    if(family == 0xF) family += ((eax >> 20) & 0xFF);
+
+    return !(amd && family < 0x19);
+#else
+    return false;
+#endif
 }
 
-U64 MagicBitboardUtils::magicRookAttacks(U64 occ, int sq) {
-    occ &= BoardUtils::rookMasks[sq];
-    occ *= ROOK_MAGICS[sq];
-    occ >>= 64-ROOK_BITS[sq];
-    return mRookAttacks[sq][occ];
+// points the lookups to the attack table of the requested backend, returns false if pext isn't available
+bool MagicBitboardUtils::setBackend(bool pext) {
+    if(pext && !cpuHasFastPext()) return false;
+
+    usePext = pext;
+    initMagics();
+    return true;
 }
 
-// the function we will call when initializing the engine
 void MagicBitboardUtils::initMagics() {
+    // split the attack table between the squares
+    const U64 *table = (usePext ? pextAttackTable.data() : magicAttackTable.data());
+    int offset = 0;
     for(int i = 0; i < 64; i++) {
-        populateSlidingAttacks(i, BISHOP_BITS[i], 1);
-        populateSlidingAttacks(i, ROOK_BITS[i], 0); 
+        mRookAttacks[i] = table + offset;
+        offset += (1 << ROOK_BITS[i]);
+
+        mBishopAttacks[i] = table + offset;
+        offset += (1 << BISHOP_BITS[i]);
     }
+    assert(offset == ATTACK_TABLE_SIZE);
 }
 
 // function for generating magic numbers
@@ -3,6 +3,13 @@
 #ifndef MAGICBITBOARDS_H_
 #define MAGICBITBOARDS_H_
 
+#include "BoardUtils.h"
+#include "Cpu.h"
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
 typedef unsigned long long U64;
 typedef const U64 C64;
 
@@ -11,23 +18,72 @@ private:
     static const int ROOK_BITS[64], BISHOP_BITS[64];
     static const int BitTable[64];
     static C64 BISHOP_MAGICS[64], ROOK_MAGICS[64];
-    static U64 mBishopAttacks[64][512], mRookAttacks[64][4096];
+
+    // "fancy" magics: every square only gets as many entries as its index can take (2^bits)
+    // all of them live in one dense array per backend, the rook and bishop entries of a square next to each other
+    // the arrays for both backends are generated at compile time, so they are read-only data
+    static const int ATTACK_TABLE_SIZE = 102400 + 5248;
+    static const std::array<U64, ATTACK_TABLE_SIZE> magicAttackTable, pextAttackTable;
+    static const U64 *mBishopAttacks[64], *mRookAttacks[64];
 
     static U64 randomU64FewBits();
     static int popFirstBit(U64 *bb);
     static U64 indexToU64(int index, int bits, U64 m);
-    static U64 rookAttacks(int sq, U64 blockers);
-    static U64 bishopAttacks(int sq, U64 blockers);
-    static void populateSlidingAttacks(int sq, int m, bool bishop);
+    static U64 slidingAttacks(int sq, U64 blockers, bool bishop);
+    static constexpr U64 pextIndex(U64 blockers, U64 mask);
+    static constexpr std::array<U64, ATTACK_TABLE_SIZE> generateAttackTable(bool pext);
     static U64 findMagic(int sq, int m, int bishop);
     static void generateMagicNumbers();
+
+    // parallel bit extract, only executed when the cpu supports bmi2
+    HOT_INLINE inline static U64 pext(U64 bb, U64 mask) {
+#if defined(__BMI2__)
+        return _pext_u64(bb, mask);
+#elif defined(__x86_64__) && defined(__GNUC__)
+        // the instruction is emitted directly, so the engine doesn't have to be compiled with bmi2 to use it
+        U64 res;
+        asm("pextq %2, %1, %0" : "=r"(res) : "r"(bb), "rm"(mask));
+        return res;
+#else
+        U64 res = 0;
+        for(U64 bit = 1; mask; bit <<= 1, mask &= (mask-1))
+            if(bb & mask & (~mask+1)) res |= bit;
+        return res;
+#endif
+    }
 public:
+    // the attack tables are indexed either with pext (bmi2) or with magic multiplication
+    // the backend is chosen at startup and the lookups are pointed to its table
+    static bool usePext;
+
+    static bool cpuHasFastPext();
+    static bool setBackend(bool pext);
     static void initMagics();
-    static U64 magicBishopAttacks(U64 occ, int sq);
-    static U64 magicRookAttacks(U64 occ, int sq);
-    static int popcount(U64 bb);
     static U64 randomULL();
-    static int bitscanForward(U64 bb);
+
+    // the lookups are used in the inner loops of move generation so they are defined here to be inlined
+    HOT_INLINE inline static U64 magicBishopAttacks(U64 occ, int sq) {
+        if(usePext) return mBishopAttacks[sq][pext(occ, BoardUtils::bishopMasks[sq])];
+
+        occ &= BoardUtils::bishopMasks[sq];
+        occ *= BISHOP_MAGICS[sq];
+        occ >>= 64-BISHOP_BITS[sq];
+        return mBishopAttacks[sq][occ];
+    }
+    HOT_INLINE inline static U64 magicRookAttacks(U64 occ, int sq) {
+        if(usePext) return mRookAttacks[sq][pext(occ, BoardUtils::rookMasks[sq])];
+
+        occ &= BoardUtils::rookMasks[sq];
+        occ *= ROOK_MAGICS[sq];
+        occ >>= 64-ROOK_BITS[sq];
+        return mRookAttacks[sq][occ];
+    }
+
+    // number of set bits
+    HOT_INLINE inline static int popcount(U64 bb) { return __builtin_popcountll(bb); }
+
+    // index of least significant set bit
+    HOT_INLINE inline static int bitscanForward(U64 bb) { return __builtin_ctzll(bb); }
 };
 
 
@@ -1,16 +1,31 @@
 #include <unordered_map>
 #include <thread>
+#include <string>
+#include <algorithm>
 
 #include "Search.h"
 #include "Evaluate.h"
 #include "Board.h"
 #include "MagicBitboardUtils.h"
 #include "TranspositionTable.h"
+#include "Perft.h"
 #include "UCI.h"
 
-int main() {
+int main(int argc, char **argv) {
     init();
 
+    // ciorap-bot bench [depth] [hashMB] [threads] runs the bench and exits
+    if(argc > 1 && std::string(argv[1]) == "bench") {
+        UCI::bench(argc > 2 ? std::stoi(argv[2]) : UCI::BENCH_DEPTH, argc > 3 ? std::stoi(argv[3]) : 16, argc > 4 ? std::stoi(argv[4]) : 1);
+        return 0;
+    }
+
+    // ciorap-bot perftsuite <file.epd> [max depth] runs the perft suite and exits with 1 if a count is wrong
+    if(argc > 2 && std::string(argv[1]) == "perftsuite") {
+        bool ok = Perft::runSuite(argv[2], argc > 3 ? std::stoi(argv[3]) : 100, std::max(1, (int)std::thread::hardware_concurrency()));
+        return (ok ? 0 : 1);
+    }
+
     std::thread communicationThread(UCI::UCICommunication);
     std::thread searchThread(UCI::inputGo);
 
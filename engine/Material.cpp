@@ -0,0 +1,107 @@
+#include "Material.h"
+#include "Endgame.h"
+#include "Evaluate.h"
+#include "Board.h"
+#include "Enums.h"
+
+using namespace std;
+
+const int Material::DRAW_NONE = 0;
+const int Material::DRAW_ALWAYS = 1;
+const int Material::DRAW_SAME_COLOR_BISHOPS = 2;
+
+Material::Entry Material::table[SIZE];
+
+// get the entry of the current material signature, computing it if it isn't in the table
+Material::Entry *Material::probe(Board *b) {
+    Entry *e = &table[b->materialKey & (SIZE-1)];
+    if(e->key != b->materialKey) computeEntry(b, e);
+
+    return e;
+}
+
+void Material::clear() {
+    for(int i = 0; i < SIZE; i++) table[i].key = 0;
+}
+
+void Material::computeEntry(Board *b, Entry *e) {
+    int pawns[2], knights[2], bishops[2], rooks[2], queens[2], pieceMaterial[2];
+    for(int color: {White, Black}) {
+        int c = (int)(color == White);
+        pawns[c] = b->pieceCount[color | Pawn];
+        knights[c] = b->pieceCount[color | Knight];
+        bishops[c] = b->pieceCount[color | Bishop];
+        rooks[c] = b->pieceCount[color | Rook];
+        queens[c] = b->pieceCount[color | Queen];
+
+        pieceMaterial[c] = knights[c] * PIECE_VALUES[Knight] + bishops[c] * PIECE_VALUES[Bishop]
+                         + rooks[c] * PIECE_VALUES[Rook] + queens[c] * PIECE_VALUES[Queen];
+    }
+
+    e->key = b->materialKey;
+
+    e->phase = (knights[0] + knights[1]) * MG_WEIGHT[Knight] + (bishops[0] + bishops[1]) * MG_WEIGHT[Bishop]
+             + (rooks[0] + rooks[1]) * MG_WEIGHT[Rook] + (queens[0] + queens[1]) * MG_WEIGHT[Queen];
+
+    // bishop and knight pairs
+    e->imbalance = 0;
+    if(bishops[1] >= 2) e->imbalance += BISHOP_PAIR;
+    if(bishops[0] >= 2) e->imbalance -= BISHOP_PAIR;
+    if(knights[1] >= 2) e->imbalance -= KNIGHT_PAIR_PENALTY;
+    if(knights[0] >= 2) e->imbalance += KNIGHT_PAIR_PENALTY;
+
+    // low material corrections (adjusting the score for well known draws)
+    for(int s = 0; s < 2; s++) {
+        int w = (s ^ 1);
+        int strongerPieces = pieceMaterial[s], weakerPieces = pieceMaterial[w];
+
+        e->scale[s] = SCALE_NORMAL;
+        if(pawns[s]) continue;
+
+        // weaker side cannot be checkmated
+        if(strongerPieces < 400) e->scale[s] = 0;
+        else if(pawns[w] == 0 && weakerPieces == 2*PIECE_VALUES[Knight]) e->scale[s] = 0;
+
+        // two knights can't force mate
+        else if(strongerPieces == 2*PIECE_VALUES[Knight] && knights[s] == 2) e->scale[s] = 0;
+
+        // rook vs minor piece
+        else if(strongerPieces == PIECE_VALUES[Rook] && (weakerPieces == PIECE_VALUES[Knight] || weakerPieces == PIECE_VALUES[Bishop]))
+            e->scale[s] = SCALE_NORMAL / 2;
+
+        // rook and minor vs rook
+        else if((strongerPieces == PIECE_VALUES[Rook] + PIECE_VALUES[Bishop] || strongerPieces == PIECE_VALUES[Rook] + PIECE_VALUES[Knight])
+           && weakerPieces == PIECE_VALUES[Rook])
+            e->scale[s] = SCALE_NORMAL / 2;
+    }
+
+    // insufficient material
+    e->drawType = DRAW_NONE;
+    if(pawns[0] + pawns[1] + rooks[0] + rooks[1] + queens[0] + queens[1] == 0) {
+        int minors = knights[0] + knights[1] + bishops[0] + bishops[1];
+
+        if(minors <= 1) e->drawType = DRAW_ALWAYS; // king vs king or king and minor piece vs king
+        // only bishops (two of one side are possible after an underpromotion), a draw if they are all on one color
+        else if(knights[0] + knights[1] == 0) e->drawType = DRAW_SAME_COLOR_BISHOPS;
+    }
+
+    // specialised endgames
+    e->endgame = nullptr;
+    e->strongSide = White;
+    for(int s = 0; s < 2; s++) {
+        int w = (s ^ 1);
+        bool weakBare = (pawns[w] == 0 && pieceMaterial[w] == 0);
+
+        EndgameFunction f = nullptr;
+        if(weakBare && pawns[s] == 1 && pieceMaterial[s] == 0) f = &Endgame::evaluateKPK;
+        else if(weakBare && pawns[s] == 0 && knights[s] == 1 && bishops[s] == 1 && rooks[s] + queens[s] == 0) f = &Endgame::evaluateKBNK;
+        else if(weakBare && pawns[s] == 0 && (queens[s] || rooks[s] || bishops[s] >= 2 || (bishops[s] && knights[s]))) f = &Endgame::evaluateKXK;
+        else if(pawns[s] + pawns[w] == 0 && pieceMaterial[s] == PIECE_VALUES[Queen] && queens[s] == 1
+             && pieceMaterial[w] == PIECE_VALUES[Rook] && rooks[w] == 1) f = &Endgame::evaluateKQKR;
+
+        if(f != nullptr) {
+            e->endgame = f;
+            e->strongSide = (s ? White : Black);
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#ifndef MATERIAL_H_
+#define MATERIAL_H_
+
+#include "Board.h"
+
+typedef int (*EndgameFunction)(int strongSide);
+
+// ---material hash table---
+// everything that only depends on the number of pieces of each type is computed once per material signature
+// the entries are indexed by the material key, which is updated incrementally in makeMove / unmakeMove
+class Material {
+public:
+    struct Entry {
+        U64 key;
+        int phase;
+        int imbalance; // from white's point of view
+        int scale[2]; // scale factor applied to the evaluation when the side is the stronger one (1 -> white, 0 -> black)
+        int drawType;
+        int strongSide;
+        EndgameFunction endgame; // specialised evaluation function, nullptr if there is none
+    };
+
+    static const int SIZE = 8192;
+    static const int SCALE_NORMAL = 64;
+    static const int DRAW_NONE, DRAW_ALWAYS, DRAW_SAME_COLOR_BISHOPS;
+
+    static Entry *probe(Board *b);
+    static void clear();
+
+private:
+    static Entry table[SIZE];
+
+    static void computeEntry(Board *b, Entry *e);
+};
+
+#endif
@@ -3,39 +3,47 @@
 #ifndef MOVEUTILS_H_
 #define MOVEUTILS_H_
 
-#include "BoardUtils.h"
-
-// // move information is stored in an int as follows:
-// // first 6 bits are the starting square, next 6 are the to square
-// // bit 12 is the color of the moved piece
-// // bits 13-15 are the piece that is being moved, bits 16-18 are the captured piece
-// // bits 19-21 are the promoted piece
-// // bits 22 and 23 are flags that indicate if the move is a castle or an en passant
+#include <cstdint>
+
+#include "Enums.h"
+
+// move information is stored in 16 bits as follows:
+// first 6 bits are the starting square, next 6 are the to square
+// bits 12-13 are the promoted piece (knight, bishop, rook or queen)
+// bits 14-15 are a flag that indicates if the move is a promotion, an en passant or a castle
+// the moved and captured pieces are not stored, they are read from the board before the move is made
+typedef uint16_t Move;
+
+// move with a score used for move ordering
+struct ScoredMove {
+    Move move;
+    int16_t score;
+};
+
 class MoveUtils {
 public:
-    static const int NO_MOVE = 0;
-    static const int CAPTURE_MASK = ((1 << 16) | (1 << 17) | (1 << 18));
-    static const int PROM_MASK = ((1 << 19) | (1 << 20) | (1 << 21));
+    static constexpr Move NO_MOVE = 0;
     static const int FROM_MASK = 63; // first 6 bits
-    static const int TO_MASK = ((1 << 6) | (1 << 7) | (1 << 8) | (1 << 9) | (1 << 10) | (1 << 11));
-    static const int PIECE_MASK = ((1 << 13) | (1 << 14) | (1 << 15));
+    static const int TO_MASK = (63 << 6);
+
+    static const int NORMAL = 0;
+    static const int PROMOTION = 1;
+    static const int EN_PASSANT = 2;
+    static const int CASTLE = 3;
 
-    
-    inline static int getMove(int from, int to, bool color, int fromPiece, int capturedPiece, int prom, bool castle, bool ep) {
-        return (from | (to << 6) | ((int)(color) << 12) | (fromPiece << 13) | 
-            (capturedPiece << 16) | (prom << 19) | ((int)(castle) << 22) | ((int)(ep) << 23));
+    inline static Move getMove(int from, int to, int flag = NORMAL, int prom = Knight) {
+        return (Move)(from | (to << 6) | ((prom - Knight) << 12) | (flag << 14));
     }
-    inline static bool isCastle(int move) { return (move & BoardUtils::bits[22]); }
-    inline static bool isEP(int move) { return (move & BoardUtils::bits[23]); }
-    inline static bool isCapture(int move) { return (move & CAPTURE_MASK); }
-    inline static bool isPromotion(int move) { return (move & PROM_MASK); }
-
-    inline static int getFromSq(int move) { return (move & FROM_MASK); }
-    inline static int getToSq(int move) { return ((move & TO_MASK) >> 6); }
-    inline static int getColor(int move) { return ((move & BoardUtils::bits[12]) >> 9); }
-    inline static int getPiece(int move) { return ((move & PIECE_MASK) >> 13); }
-    inline static int getCapturedPiece(int move) { return ((move & CAPTURE_MASK) >> 16); }
-    inline static int getPromotionPiece(int move) { return ((move & PROM_MASK) >> 19); }
+    inline static int getFlag(Move move) { return (move >> 14); }
+    inline static bool isCastle(Move move) { return (getFlag(move) == CASTLE); }
+    inline static bool isEP(Move move) { return (getFlag(move) == EN_PASSANT); }
+    inline static bool isPromotion(Move move) { return (getFlag(move) == PROMOTION); }
+
+    inline static int getFromSq(Move move) { return (move & FROM_MASK); }
+    inline static int getToSq(Move move) { return ((move & TO_MASK) >> 6); }
+
+    // returns Empty if the move is not a promotion
+    inline static int getPromotionPiece(Move move) { return (isPromotion(move) ? ((move >> 12) & 3) + Knight : Empty); }
 };
 
-#endif
\ No newline at end of file
+#endif
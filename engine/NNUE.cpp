@@ -0,0 +1,224 @@
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <cassert>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "NNUE.h"
+#include "Board.h"
+#include "MagicBitboardUtils.h"
+#include "MoveUtils.h"
+#include "Enums.h"
+#include "Cpu.h"
+
+using namespace std;
+
+bool NNUE::useNNUE = false;
+bool NNUE::loaded = false;
+string NNUE::evalFile = "ciorap.nnue";
+
+// "CNN1" in little endian
+const uint32_t NNUE::FILE_MAGIC = 0x314E4E43;
+
+// king buckets from the point of view of the side, after mirroring the king to the a-d files
+const int NNUE::KING_BUCKET_TABLE[64] = {
+    0, 0, 1, 1, 1, 1, 0, 0,
+    2, 2, 2, 2, 2, 2, 2, 2,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3
+};
+
+alignas(32) int16_t NNUE::featureWeights[INPUT_SIZE][HIDDEN_SIZE];
+alignas(32) int16_t NNUE::featureBiases[HIDDEN_SIZE];
+alignas(32) int16_t NNUE::outputWeights[2 * HIDDEN_SIZE];
+int32_t NNUE::outputBias;
+
+// network file layout (little endian):
+// u32 magic, u32 king buckets, u32 hidden size,
+// i16 feature weights [INPUT_SIZE][HIDDEN_SIZE], i16 feature biases [HIDDEN_SIZE],
+// i8 output weights [2 * HIDDEN_SIZE] (side to move half first), i32 output bias
+bool NNUE::loadNetwork(const string& path) {
+    ifstream fin(path, ios::binary);
+    if(!fin) return false;
+
+    uint32_t header[3];
+    fin.read((char*)header, sizeof(header));
+    if(!fin || header[0] != FILE_MAGIC || header[1] != KING_BUCKETS || header[2] != HIDDEN_SIZE) return false;
+
+    static int8_t rawOutputWeights[2 * HIDDEN_SIZE];
+
+    fin.read((char*)featureWeights, sizeof(featureWeights));
+    fin.read((char*)featureBiases, sizeof(featureBiases));
+    fin.read((char*)rawOutputWeights, sizeof(rawOutputWeights));
+    fin.read((char*)&outputBias, sizeof(outputBias));
+    if(!fin) {
+        loaded = false;
+        return false;
+    }
+
+    // widen the output weights once so that inference can use 16 bit multiply-adds
+    for(int i = 0; i < 2 * HIDDEN_SIZE; i++)
+        outputWeights[i] = rawOutputWeights[i];
+
+    loaded = true;
+    return true;
+}
+
+// squares are seen from the side's point of view and mirrored so that its king is always on the a-d files
+int NNUE::featureIndex(int piece, int color, int sq, int kingSq, int perspective) {
+    if(perspective == Black) {
+        sq ^= 56;
+        kingSq ^= 56;
+    }
+    if((kingSq & 7) >= 4) {
+        sq ^= 7;
+        kingSq ^= 7;
+    }
+
+    int side = (color == perspective ? 0 : 1);
+    return KING_BUCKET_TABLE[kingSq] * 768 + (side * 6 + piece - 1) * 64 + sq;
+}
+
+// the king of the perspective side moved, so every feature changes if the bucket or the mirroring changes
+bool NNUE::needsRefresh(int from, int to, int perspective) {
+    if(perspective == Black) {
+        from ^= 56;
+        to ^= 56;
+    }
+    bool mirrorFrom = ((from & 7) >= 4), mirrorTo = ((to & 7) >= 4);
+    if(mirrorFrom != mirrorTo) return true;
+
+    if(mirrorFrom) {
+        from ^= 7;
+        to ^= 7;
+    }
+    return KING_BUCKET_TABLE[from] != KING_BUCKET_TABLE[to];
+}
+
+// compute the accumulator of one side from scratch
+HOT_KERNEL void NNUE::refresh(Board *b, Accumulator& acc, int perspective) {
+    int16_t *values = acc.values[(int)(perspective == White)];
+    int kingSq = (perspective == White ? b->whiteKingSquare : b->blackKingSquare);
+
+    memcpy(values, featureBiases, sizeof(featureBiases));
+
+    U64 occ = b->occupiedBB();
+    while(occ) {
+        int sq = MagicBitboardUtils::bitscanForward(occ);
+        int color = (b->squares[sq] & (Black | White));
+        int piece = (b->squares[sq] ^ color);
+
+        const int16_t *w = featureWeights[featureIndex(piece, color, sq, kingSq, perspective)];
+        for(int i = 0; i < HIDDEN_SIZE; i++) values[i] += w[i];
+
+        occ &= (occ-1);
+    }
+}
+
+// next = prev + added features - removed features, in a single pass over the accumulator
+HOT_KERNEL void NNUE::applyDelta(const int16_t *prev, int16_t *next, const int *added, int numAdded, const int *removed, int numRemoved) {
+#if defined(__AVX2__)
+    for(int i = 0; i < HIDDEN_SIZE; i += 16) {
+        __m256i v = _mm256_load_si256((const __m256i*)(prev + i));
+        for(int j = 0; j < numAdded; j++)
+            v = _mm256_add_epi16(v, _mm256_load_si256((const __m256i*)(featureWeights[added[j]] + i)));
+        for(int j = 0; j < numRemoved; j++)
+            v = _mm256_sub_epi16(v, _mm256_load_si256((const __m256i*)(featureWeights[removed[j]] + i)));
+        _mm256_store_si256((__m256i*)(next + i), v);
+    }
+#else
+    memcpy(next, prev, HIDDEN_SIZE * sizeof(int16_t));
+    for(int j = 0; j < numAdded; j++) {
+        const int16_t *w = featureWeights[added[j]];
+        for(int i = 0; i < HIDDEN_SIZE; i++) next[i] += w[i];
+    }
+    for(int j = 0; j < numRemoved; j++) {
+        const int16_t *w = featureWeights[removed[j]];
+        for(int i = 0; i < HIDDEN_SIZE; i++) next[i] -= w[i];
+    }
+#endif
+}
+
+// called after the move was made on the board, so the moved and captured pieces are passed by the caller
+void NNUE::update(Board *b, const Accumulator& prev, Accumulator& next, Move move, int piece, int capturedPiece) {
+    int from = MoveUtils::getFromSq(move);
+    int to = MoveUtils::getToSq(move);
+
+    int color = (b->squares[to] & 8);
+    int otherColor = (color ^ 8);
+    int promotionPiece = MoveUtils::getPromotionPiece(move);
+
+    for(int perspective: {White, Black}) {
+        int p = (int)(perspective == White);
+
+        if(piece == King && color == perspective && needsRefresh(from, to, perspective)) {
+            refresh(b, next, perspective);
+            continue;
+        }
+
+        int kingSq = (perspective == White ? b->whiteKingSquare : b->blackKingSquare);
+        int added[2], removed[2];
+        int numAdded = 0, numRemoved = 0;
+
+        removed[numRemoved++] = featureIndex(piece, color, from, kingSq, perspective);
+        added[numAdded++] = featureIndex((promotionPiece ? promotionPiece : piece), color, to, kingSq, perspective);
+
+        if(capturedPiece != Empty) {
+            int capturedSq = (MoveUtils::isEP(move) ? to + (color == White ? south : north) : to);
+            removed[numRemoved++] = featureIndex(capturedPiece, otherColor, capturedSq, kingSq, perspective);
+        }
+
+        if(MoveUtils::isCastle(move)) {
+            int rank = (to >> 3), file = (to & 7);
+            int rookStartSquare = (rank << 3) + (file == 6 ? 7 : 0);
+            int rookEndSquare = (rank << 3) + (file == 6 ? 5 : 3);
+
+            removed[numRemoved++] = featureIndex(Rook, color, rookStartSquare, kingSq, perspective);
+            added[numAdded++] = featureIndex(Rook, color, rookEndSquare, kingSq, perspective);
+        }
+
+        assert(numAdded <= 2 && numRemoved <= 2);
+        applyDelta(prev.values[p], next.values[p], added, numAdded, removed, numRemoved);
+    }
+}
+
+// clipped relu on both halves of the accumulator and the output layer, from the side to move's point of view
+HOT_KERNEL int NNUE::evaluate(Board *b, const Accumulator& acc) {
+    const int16_t *us = acc.values[(int)(b->turn == White)];
+    const int16_t *them = acc.values[(int)(b->turn != White)];
+
+    int32_t sum = 0;
+
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i qa = _mm256_set1_epi16(QA);
+    __m256i total = _mm256_setzero_si256();
+
+    for(int i = 0; i < HIDDEN_SIZE; i += 16) {
+        __m256i u = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*)(us + i)), zero), qa);
+        __m256i t = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*)(them + i)), zero), qa);
+
+        total = _mm256_add_epi32(total, _mm256_madd_epi16(u, _mm256_load_si256((const __m256i*)(outputWeights + i))));
+        total = _mm256_add_epi32(total, _mm256_madd_epi16(t, _mm256_load_si256((const __m256i*)(outputWeights + HIDDEN_SIZE + i))));
+    }
+
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+    sum = _mm_cvtsi128_si32(s);
+#else
+    for(int i = 0; i < HIDDEN_SIZE; i++) {
+        sum += min(max((int)us[i], 0), (int)QA) * outputWeights[i];
+        sum += min(max((int)them[i], 0), (int)QA) * outputWeights[HIDDEN_SIZE + i];
+    }
+#endif
+
+    return (int)((long long)(sum + outputBias) * SCALE / (QA * QB));
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#ifndef NNUE_H_
+#define NNUE_H_
+
+#include <string>
+#include <cstdint>
+
+#include "MoveUtils.h"
+
+class Board;
+
+// ---nnue---
+// efficiently updatable neural network evaluation
+// the input layer is a king bucketed piece-square layer (768 features for every king bucket, from the point of view of each side)
+// its output, the accumulator, is updated incrementally when making moves and only recomputed when a king changes its bucket
+class NNUE {
+public:
+    static const int KING_BUCKETS = 4;
+    static const int INPUT_SIZE = 768 * KING_BUCKETS;
+    static const int HIDDEN_SIZE = 256;
+    static const int STACK_SIZE = 1024;
+
+    // quantisation: the accumulator is int16 scaled by QA, the output weights are int8 scaled by QB
+    static const int QA = 127;
+    static const int QB = 64;
+    static const int SCALE = 400;
+
+    struct Accumulator {
+        // index 1 -> white's point of view, 0 -> black's point of view
+        alignas(32) int16_t values[2][HIDDEN_SIZE];
+    };
+
+    static bool useNNUE;
+    static std::string evalFile;
+
+    static bool loadNetwork(const std::string& path);
+    inline static bool isActive() { return useNNUE && loaded; }
+
+    static void refresh(Board *b, Accumulator& acc, int perspective);
+    static void update(Board *b, const Accumulator& prev, Accumulator& next, Move move, int piece, int capturedPiece);
+    static int evaluate(Board *b, const Accumulator& acc);
+
+private:
+    static bool loaded;
+
+    static const uint32_t FILE_MAGIC;
+    static const int KING_BUCKET_TABLE[64];
+
+    alignas(32) static int16_t featureWeights[INPUT_SIZE][HIDDEN_SIZE];
+    alignas(32) static int16_t featureBiases[HIDDEN_SIZE];
+    alignas(32) static int16_t outputWeights[2 * HIDDEN_SIZE];
+    static int32_t outputBias;
+
+    static int featureIndex(int piece, int color, int sq, int kingSq, int perspective);
+    static bool needsRefresh(int from, int to, int perspective);
+    static void applyDelta(const int16_t *prev, int16_t *next, const int *added, int numAdded, const int *removed, int numRemoved);
+};
+
+#endif
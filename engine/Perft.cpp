@@ -0,0 +1,158 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+#include "Perft.h"
+#include "Board.h"
+#include "BoardUtils.h"
+#include "MoveUtils.h"
+
+using namespace std;
+
+Perft::Entry *Perft::table = nullptr;
+
+// returns the cached count of the position at this depth, or -1 if there is none
+long long Perft::probe(U64 key, short depth) {
+    // the depth is mixed into the index, so the counts of a position at different depths don't replace each other
+    Entry &e = table[(key ^ (depth * 0x9E3779B97F4A7C15ULL)) & (TABLE_SIZE-1)];
+
+    U64 data = e.data.load(memory_order_relaxed);
+    if((e.key.load(memory_order_relaxed) ^ data) != key || (int)(data & 255) != depth) return -1;
+
+    return (long long)(data >> 8);
+}
+
+void Perft::store(U64 key, short depth, long long count) {
+    Entry &e = table[(key ^ (depth * 0x9E3779B97F4A7C15ULL)) & (TABLE_SIZE-1)];
+
+    U64 data = (((U64)count << 8) | (U64)depth);
+    e.key.store(key ^ data, memory_order_relaxed);
+    e.data.store(data, memory_order_relaxed);
+}
+
+// the leaves are counted in bulk: at depth 1 the number of legal moves is the number of leaves
+template<bool Hashed> long long Perft::count(Board &b, short depth) {
+    if(depth == 0) return 1;
+
+    Move moves[256];
+    int num = b.generateLegalMoves(moves);
+    if(depth == 1) return num;
+
+    if constexpr (Hashed) {
+        long long cached = probe(b.hashKey, depth);
+        if(cached >= 0) return cached;
+    }
+
+    long long numPos = 0;
+    for(int idx = 0; idx < num; idx++) {
+        b.makeMove(moves[idx]);
+        numPos += count<Hashed>(b, depth-1);
+        b.unmakeMove(moves[idx]);
+    }
+
+    if constexpr (Hashed) store(b.hashKey, depth, numPos);
+    return numPos;
+}
+
+// perft from the given position, printing the count of every root move if divide is set
+long long Perft::run(Board *root, short depth, bool divide, int threads, bool hashed) {
+    if(depth <= 0) return 1;
+    if(hashed && table == nullptr) clear();
+
+    Move moves[256];
+    int num = root->generateLegalMoves(moves);
+
+    // every thread takes the next root move that hasn't been taken yet
+    vector<long long> counts(num);
+    atomic<int> nextMove(0);
+    auto worker = [&]() {
+        Board b(*root);
+        for(int idx = nextMove++; idx < num; idx = nextMove++) {
+            b.makeMove(moves[idx]);
+            counts[idx] = (hashed ? count<true>(b, depth-1) : count<false>(b, depth-1));
+            b.unmakeMove(moves[idx]);
+        }
+    };
+
+    vector<thread> pool;
+    for(int i = 0; i < max(1, min(threads, num)); i++) pool.emplace_back(worker);
+    for(thread &t: pool) t.join();
+
+    long long numPos = 0;
+    for(int idx = 0; idx < num; idx++) {
+        if(divide) cout << BoardUtils::moveToString(moves[idx]) << ": " << counts[idx] << '\n';
+        numPos += counts[idx];
+    }
+    return numPos;
+}
+
+// runs every position of an epd file up to maxDepth and compares the counts with the expected ones
+// every line is a fen followed by the expected counts, e.g. "<fen> ;D1 20 ;D2 400 ;D3 8902"
+// returns true if all the counts match
+bool Perft::runSuite(const string &fileName, short maxDepth, int threads) {
+    ifstream file(fileName);
+    if(!file.is_open()) {
+        cout << "info string could not open " << fileName << '\n';
+        return false;
+    }
+
+    Board b;
+    int positions = 0, runs = 0, failed = 0;
+    long long totalNodes = 0, totalTime = 0;
+    cout << "perftsuite: " << fileName << " threads " << threads << " (without the hash table)\n";
+
+    string line;
+    while(getline(file, line)) {
+        size_t fenEnd = line.find(';');
+        if(fenEnd == string::npos) continue;
+
+        string fen = line.substr(0, fenEnd);
+        while(!fen.empty() && fen.back() == ' ') fen.pop_back();
+        if(fen.empty() || fen[0] == '#') continue;
+
+        b.loadFenPos(fen);
+        positions++;
+        cout << "position " << positions << ": " << fen << '\n';
+
+        istringstream fields(line.substr(fenEnd));
+        string token;
+        long long expected;
+        while(fields >> token >> expected) {
+            // token is ";D<depth>"
+            short depth = stoi(token.substr(2));
+            if(depth > maxDepth) continue;
+
+            long long startTime = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+            long long nodes = run(&b, depth, false, threads, false);
+            long long time = max(1LL, chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count() - startTime);
+
+            bool ok = (nodes == expected);
+            runs++;
+            if(!ok) failed++;
+            totalNodes += nodes;
+            totalTime += time;
+
+            cout << "  depth " << depth << " nodes " << nodes << " expected " << expected << " time " << time
+                 << " nps " << 1000LL*nodes/time << (ok ? " ok" : " MISMATCH") << '\n';
+        }
+    }
+
+    totalTime = max(1LL, totalTime);
+    cout << "perftsuite: threads " << threads << " positions " << positions << " runs " << runs << " failed " << failed << " nodes " << totalNodes
+         << " time " << totalTime << " nps " << 1000LL*totalNodes/totalTime << '\n';
+
+    return (failed == 0);
+}
+
+void Perft::clear() {
+    if(table == nullptr) table = new Entry[TABLE_SIZE];
+
+    for(int i = 0; i < TABLE_SIZE; i++) {
+        table[i].key.store(0, memory_order_relaxed);
+        table[i].data.store(0, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#ifndef PERFT_H_
+#define PERFT_H_
+
+#include <atomic>
+#include <string>
+
+#include "Board.h"
+
+// ---perft---
+// counts the leaf nodes of the move generation tree, used to validate the move generator
+// the root moves are split between threads (each one with its own copy of the board)
+// and the counts of the subtrees are cached in a hash table shared by all of them
+class Perft {
+private:
+    // lockless entry: the key is stored xored with the data, so an entry that was
+    // half written by another thread doesn't match any position
+    struct Entry {
+        std::atomic<U64> key, data; // data = (count << 8) | depth
+    };
+
+    static const int TABLE_SIZE = (1 << 21);
+    static Entry *table;
+
+    static long long probe(U64 key, short depth);
+    static void store(U64 key, short depth, long long count);
+    template<bool Hashed> static long long count(Board &b, short depth);
+
+public:
+    // the suite doesn't use the hash table (hashed = false), so that its times measure move generation and make/unmake
+    static long long run(Board *root, short depth, bool divide, int threads, bool hashed = true);
+    static bool runSuite(const std::string &fileName, short maxDepth, int threads);
+    static void clear();
+};
+
+#endif
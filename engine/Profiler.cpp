@@ -0,0 +1,83 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+#include "Profiler.h"
+
+using namespace std;
+
+#if PROFILE
+
+static const char *SECTION_NAMES[PROFILE_SECTIONS] = {
+    "search",
+    "generateLegalMoves", "generateLegalMovesQS",
+    "makeMove", "unmakeMove",
+    "evaluate",
+    "probeHash", "recordHash",
+    "sortMoves",
+    "isDraw", "hasUpcomingRepetition"
+};
+
+// the accumulators of the running threads, and the sums of the threads that have finished
+static mutex accumulatorsMutex;
+static vector<Profiler::Accumulator*> accumulators;
+static U64 finishedCalls[PROFILE_SECTIONS], finishedCycles[PROFILE_SECTIONS];
+
+thread_local Profiler::Accumulator Profiler::local;
+
+Profiler::Accumulator::Accumulator() : calls(), cycles() {
+    lock_guard<mutex> lk(accumulatorsMutex);
+    accumulators.push_back(this);
+}
+
+Profiler::Accumulator::~Accumulator() {
+    lock_guard<mutex> lk(accumulatorsMutex);
+    for(int i = 0; i < PROFILE_SECTIONS; i++) {
+        finishedCalls[i] += calls[i];
+        finishedCycles[i] += cycles[i];
+    }
+    accumulators.erase(find(accumulators.begin(), accumulators.end(), this));
+}
+
+// calls, cycles per call and share of the search time of every section, summed over all the threads
+// the counters of running threads are read without stopping them, so print this while no search is running
+void Profiler::print() {
+    U64 calls[PROFILE_SECTIONS], cycles[PROFILE_SECTIONS];
+    {
+        lock_guard<mutex> lk(accumulatorsMutex);
+        for(int i = 0; i < PROFILE_SECTIONS; i++) {
+            calls[i] = finishedCalls[i];
+            cycles[i] = finishedCycles[i];
+            for(Accumulator *acc: accumulators) {
+                calls[i] += acc->calls[i];
+                cycles[i] += acc->cycles[i];
+            }
+        }
+    }
+
+    // without a search (e.g. after a perft) the sections are shown as a share of their sum
+    U64 total = cycles[PROFILE_SEARCH];
+    if(!total) for(int i = 1; i < PROFILE_SECTIONS; i++) total += cycles[i];
+
+    cout << fixed << setprecision(1);
+    for(int i = 0; i < PROFILE_SECTIONS; i++) {
+        if(!calls[i]) continue;
+        cout << left << setw(22) << SECTION_NAMES[i] << right << " calls " << setw(12) << calls[i]
+             << " cycles/call " << setw(10) << (double)cycles[i] / calls[i]
+             << " share " << setw(5) << (total ? 100.0 * cycles[i] / total : 0.0) << "%\n";
+    }
+    cout << defaultfloat;
+    cout.flush();
+}
+
+void Profiler::clear() {
+    lock_guard<mutex> lk(accumulatorsMutex);
+    for(int i = 0; i < PROFILE_SECTIONS; i++) finishedCalls[i] = finishedCycles[i] = 0;
+    for(Accumulator *acc: accumulators) {
+        for(int i = 0; i < PROFILE_SECTIONS; i++) acc->calls[i] = acc->cycles[i] = 0;
+    }
+}
+
+#endif
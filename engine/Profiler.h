@@ -0,0 +1,81 @@
+#pragma once
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+// the hot routines are timed with PROFILE_SCOPE if this is 1, otherwise it compiles to nothing
+#ifndef PROFILE
+#define PROFILE 0
+#endif
+
+enum ProfileSection {
+    PROFILE_SEARCH, // the whole search, the other sections are shown as a share of it
+    PROFILE_GENERATE_MOVES, PROFILE_GENERATE_MOVES_QS,
+    PROFILE_MAKE_MOVE, PROFILE_UNMAKE_MOVE,
+    PROFILE_EVALUATE,
+    PROFILE_PROBE_HASH, PROFILE_RECORD_HASH,
+    PROFILE_SORT_MOVES,
+    PROFILE_IS_DRAW, PROFILE_UPCOMING_REPETITION,
+    PROFILE_SECTIONS
+};
+
+#if PROFILE
+
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+typedef unsigned long long U64;
+
+// ---profiler---
+// every thread counts the calls and cycles of each section in its own accumulator,
+// the accumulators are summed when the profile is printed
+class Profiler {
+public:
+    struct Accumulator {
+        U64 calls[PROFILE_SECTIONS], cycles[PROFILE_SECTIONS];
+
+        Accumulator();
+        ~Accumulator();
+    };
+
+    static thread_local Accumulator local;
+
+    // cycles on x86, nanoseconds elsewhere
+    static inline U64 ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    static void print();
+    static void clear();
+};
+
+// adds the time from its construction to its destruction to a section
+class ProfileScope {
+private:
+    int section;
+    U64 start;
+public:
+    inline ProfileScope(int section) : section(section), start(Profiler::ticks()) {}
+    inline ~ProfileScope() {
+        Profiler::local.cycles[section] += Profiler::ticks() - start;
+        Profiler::local.calls[section]++;
+    }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(section) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(section)
+
+#else
+
+#define PROFILE_SCOPE(section)
+
+#endif
+
+#endif
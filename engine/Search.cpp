@@ -3,7 +3,6 @@
 #include <math.h>
 #include <unordered_map>
 #include <iostream>
-#include <stack>
 #include <cassert>
 #include <cstring>
 
@@ -16,14 +15,16 @@
 #include "MoveUtils.h"
 #include "BoardUtils.h"
 #include "Enums.h"
+#include "Profiler.h"
+#include "SearchTrace.h"
 
 using namespace std;
 
-int Search::bestMove = MoveUtils::NO_MOVE;
+Move Search::bestMove = MoveUtils::NO_MOVE;
 
-int Search::killerMoves[256][2];
+Move Search::killerMoves[256][2];
 int Search::history[16][64];
-const int Search::HISTORY_MAX = 1e8;
+const int Search::HISTORY_MAX = 16000;
 
 const int Search::INF = 1000000;
 const int Search::MATE_EVAL = INF-1;
@@ -32,27 +33,33 @@ const int Search::MATE_THRESHOLD = MATE_EVAL/2;
 long long Search::stopTime;
 bool Search::infiniteTime;
 
-int Search::nodesSearched = 0;
-int Search::nodesQ = 0;
+long long Search::nodesSearched = 0;
+long long Search::nodesQ = 0;
+long long Search::totalNodes = 0;
+bool Search::showInfo = true;
+SearchStats Search::stats, Search::lastStats;
+int Search::rootStateIndex = 0;
 bool Search::timeOver = false;
 
 const int Search::MAX_DEPTH = 100;
 int Search::currMaxDepth = 100;
-int Search::pvArray[(MAX_DEPTH * MAX_DEPTH + MAX_DEPTH) / 2 + MAX_DEPTH];
+Move Search::pvArray[(MAX_DEPTH * MAX_DEPTH + MAX_DEPTH) / 2 + MAX_DEPTH];
 
 const int Search::ASP_INCREASE = 50;
 
 
 // --- MOVE ORDERING ---
-int Search::captureScore(int move) {
+// the scores have to fit in the 16 bits of a ScoredMove
+int Search::captureScore(Move move) {
     int score = 0;
 
     // give huge score boost to captures of the last moved piece
-    if(!board->moveStk.empty() && MoveUtils::getToSq(move) == MoveUtils::getToSq(board->moveStk.top())) score += 2000;
+    Move lastMove = board->lastMove();
+    if(lastMove != MoveUtils::NO_MOVE && MoveUtils::getToSq(move) == MoveUtils::getToSq(lastMove)) score += 2000;
 
     // captured piece value - capturing piece value
-    if(MoveUtils::isCapture(move)) score += (PIECE_VALUES[MoveUtils::getCapturedPiece(move)]-
-                  PIECE_VALUES[MoveUtils::getPiece(move)]);
+    if(board->isCapture(move)) score += (PIECE_VALUES[board->capturedPiece(move)]-
+                  PIECE_VALUES[board->movedPiece(move)]);
 
     // material gained by promotion
     if(MoveUtils::isPromotion(move)) score += PIECE_VALUES[MoveUtils::getPromotionPiece(move)] - PIECE_VALUES[Pawn];
@@ -60,42 +67,44 @@ int Search::captureScore(int move) {
     return score;
 }
 
-int Search::nonCaptureScore(int move) {
+int Search::nonCaptureScore(Move move) {
     // start with history score
-    int score = history[(MoveUtils::getColor(move) | MoveUtils::getPiece(move))][MoveUtils::getToSq(move)];
+    int score = history[board->squares[MoveUtils::getFromSq(move)]][MoveUtils::getToSq(move)];
+    assert(score <= HISTORY_MAX);
 
     // if it is a promotion add huge bonus so that it is searched first
-    if(MoveUtils::isPromotion(move)) score += 100000000;
+    if(MoveUtils::isPromotion(move)) score += HISTORY_MAX + 1;
 
-    assert(score <= 1e9);
+    assert(score <= INT16_MAX);
     return score;
 }
 
-bool Search::cmpCapturesInv(int a, int b) {
-    return (captureScore(a) < captureScore(b));
+bool Search::cmpScoredMovesInv(const ScoredMove& a, const ScoredMove& b) {
+    return a.score < b.score;
 }
 
-bool Search::cmpCaptures(int a, int b) {
-    return (captureScore(a) > captureScore(b));
+bool Search::cmpScoredMoves(const ScoredMove& a, const ScoredMove& b) {
+    return a.score > b.score;
 }
 
-bool Search::cmpNonCaptures(int a, int b) {
-    return nonCaptureScore(a) > nonCaptureScore(b);
-}
+void Search::sortMoves(Move *moves, int num, short ply) {
+    PROFILE_SCOPE(PROFILE_SORT_MOVES);
+
+    ScoredMove captures[256], nonCaptures[256];
+    int nCaptures = 0, nNonCaptures = 0;
 
-void Search::sortMoves(int *moves, int num, short ply) {
     // sorting in quiescence search
-      if(ply == -1) {
-          sort(moves, moves+num, cmpCaptures);
-          return;
-      }
+    if(ply == -1) {
+        for(int idx = 0; idx < num; idx++) captures[idx] = {moves[idx], (int16_t)captureScore(moves[idx])};
 
-    int captures[256], nonCaptures[256];
-    unsigned int nCaptures = 0, nNonCaptures = 0;
+        sort(captures, captures + num, cmpScoredMoves);
+        for(int idx = 0; idx < num; idx++) moves[idx] = captures[idx].move;
+        return;
+    }
 
     // find hash moves
-    int hashMoveDepth = transpositionTable->retrieveDepthMove();
-    int hashMoveReplace = transpositionTable->retrieveReplaceMove();
+    Move hashMoveDepth = transpositionTable->retrieveDepthMove();
+    Move hashMoveReplace = transpositionTable->retrieveReplaceMove();
 
     // check legality of killer moves
     bool killerLegal[2] = {false, false};
@@ -105,14 +114,15 @@ void Search::sortMoves(int *moves, int num, short ply) {
     }
 
     // split the other moves into captures and non captures for easier sorting
+    // the scores are computed only once, before sorting
     for(int idx = 0; idx < num; idx++) {
         if((moves[idx] == killerMoves[ply][0]) 
         || (moves[idx] == killerMoves[ply][1]) 
         || (moves[idx] == hashMoveDepth) 
         || (moves[idx] == hashMoveReplace)) continue;
 
-        if(MoveUtils::isCapture(moves[idx])) captures[nCaptures++] = moves[idx];
-        else nonCaptures[nNonCaptures++] = moves[idx];
+        if(board->isCapture(moves[idx])) captures[nCaptures++] = {moves[idx], (int16_t)captureScore(moves[idx])};
+        else nonCaptures[nNonCaptures++] = {moves[idx], (int16_t)nonCaptureScore(moves[idx])};
     }
 
     int newNum = 0; // size of sorted array
@@ -124,9 +134,9 @@ void Search::sortMoves(int *moves, int num, short ply) {
     && hashMoveReplace != hashMoveDepth) moves[newNum++] = hashMoveReplace;
     
     // add captures sorted by MVV-LVA (only winning / equal captures first)
-    sort(captures, captures + nCaptures, cmpCapturesInv); // descending order because we add them from the end
-    while(nCaptures && captureScore(captures[nCaptures-1]) >= 0) {
-        moves[newNum++] = captures[--nCaptures];
+    sort(captures, captures + nCaptures, cmpScoredMovesInv); // descending order because we add them from the end
+    while(nCaptures && captures[nCaptures-1].score >= 0) {
+        moves[newNum++] = captures[--nCaptures].move;
     }
 
     // add killer moves
@@ -142,13 +152,13 @@ void Search::sortMoves(int *moves, int num, short ply) {
     && (killerMoves[ply][1] != hashMoveReplace)) moves[newNum++] = killerMoves[ply][1];
 
     // add other quiet moves sorted
-    sort(nonCaptures, nonCaptures + nNonCaptures, cmpNonCaptures);
-    for(unsigned int idx = 0; idx < nNonCaptures; idx++)
-        moves[newNum++] = nonCaptures[idx];
+    sort(nonCaptures, nonCaptures + nNonCaptures, cmpScoredMoves);
+    for(int idx = 0; idx < nNonCaptures; idx++)
+        moves[newNum++] = nonCaptures[idx].move;
 
     // add losing captures
     while(nCaptures) {
-        moves[newNum++] = captures[--nCaptures];
+        moves[newNum++] = captures[--nCaptures].move;
     }
 
     assert(newNum == num);
@@ -163,29 +173,38 @@ int Search::quiescence(int alpha, int beta) {
     }
     if(timeOver) return 0;
     nodesQ++;
+    SEARCH_STAT(stats.selDepth = max(stats.selDepth, board->stateIndex - rootStateIndex));
 
-    if(board->isDraw()) return 0;
+    if(board->isDraw(board->stateIndex - rootStateIndex)) return 0;
 
-    int standPat = evaluate();
+    // if we can repeat a position the score is at least a draw
+    if(alpha < 0 && board->hasUpcomingRepetition(board->stateIndex - rootStateIndex)) {
+        alpha = 0;
+        if(alpha >= beta) return beta;
+    }
+
+    // the static evaluation only matters relative to the window, so the positional terms can be skipped when it's far outside it
+    int standPat = evaluate(alpha, beta);
     if(standPat >= beta && !board->isInCheck()) return beta;
 
     alpha = max(alpha, standPat);
 
-    int moves[256];
+    Move moves[256];
     int num = board->generateLegalMovesQS(moves);
 
     sortMoves(moves, num, -1);
     for(int idx = 0; idx < num; idx++)  {
-        // if(MoveUtils::isCapture(moves[idx]) && (seeMove(moves[idx]) < 0)) continue;
+        // if(board->isCapture(moves[idx]) && (seeMove(moves[idx]) < 0)) continue;
 
         // --- DELTA PRUNING --- 
         // we test if each move has the potential to raise alpha
         // if it doesn't, then the position is hopeless so searching deeper won't improve it
-        int delta = standPat +  PIECE_VALUES[MoveUtils::getCapturedPiece(moves[idx])] + 200;
+        int capturedPiece = board->capturedPiece(moves[idx]);
+        int delta = standPat +  PIECE_VALUES[capturedPiece] + 200;
         if(MoveUtils::isPromotion(moves[idx])) delta += PIECE_VALUES[MoveUtils::getPromotionPiece(moves[idx])] - PIECE_VALUES[Pawn];
 
         const int ENDGAME_MATERIAL = 10;
-        if((delta <= alpha) && (gamePhase() - MG_WEIGHT[MoveUtils::getCapturedPiece(moves[idx])] >= ENDGAME_MATERIAL)) continue;
+        if((delta <= alpha) && (gamePhase() - MG_WEIGHT[capturedPiece] >= ENDGAME_MATERIAL)) continue;
 
         board->makeMove(moves[idx]);
         int score = -quiescence(-beta, -alpha);
@@ -202,8 +221,21 @@ int Search::quiescence(int alpha, int beta) {
     return alpha;
 }
 
-// alpha-beta algorithm with a fail-hard framework and PVS
+// the search of a node, which is written to the trace file if tracing is on
 int Search::alphaBeta(int alpha, int beta, short depth, short ply, bool doNull) {
+#if SEARCH_TRACE
+    if(SearchTrace::active) {
+        SearchTrace::enter(ply, depth, alpha, beta, board->lastMove());
+        int score = alphaBetaNode(alpha, beta, depth, ply, doNull);
+        if(!timeOver) SearchTrace::leave(ply, score);
+        return score;
+    }
+#endif
+    return alphaBetaNode(alpha, beta, depth, ply, doNull);
+}
+
+// alpha-beta algorithm with a fail-hard framework and PVS
+int Search::alphaBetaNode(int alpha, int beta, short depth, short ply, bool doNull) {
     assert(depth >= 0);
     assert(ply <= MAX_DEPTH);
 
@@ -213,6 +245,7 @@ int Search::alphaBeta(int alpha, int beta, short depth, short ply, bool doNull)
     }
     if(timeOver) return 0;
     nodesSearched++;
+    SEARCH_STAT(stats.selDepth = max(stats.selDepth, board->stateIndex - rootStateIndex));
 
     int pvIndex = ply * (2 * MAX_DEPTH + 1 - ply) / 2;
     int pvNextIndex = pvIndex + MAX_DEPTH - ply;
@@ -226,27 +259,53 @@ int Search::alphaBeta(int alpha, int beta, short depth, short ply, bool doNull)
     // if we find mate, we shouldn't look for a better move
     int matedScore = - MATE_EVAL + ply;
     int mateScore = MATE_EVAL - ply;
+    TRACE_EVENT(SearchTrace::node(ply).pruning = TRACE_PRUNE_MATE_DISTANCE);
     if (alpha >= mateScore) return alpha;
     if (beta <= matedScore) return beta;
 
-    if(board->isDraw()) return 0;
+    TRACE_EVENT(SearchTrace::node(ply).pruning = TRACE_PRUNE_DRAW);
+    // the root is searched even if it is a draw, so that there is a move to play
+    if(ply && board->isDraw(board->stateIndex - rootStateIndex)) return 0;
+    TRACE_EVENT(SearchTrace::node(ply).pruning = TRACE_PRUNE_NONE);
 
     bool isPV = (beta - alpha > 1);
 
+    // --- UPCOMING REPETITION ---
+    // if we have a move that repeats a position, the score is at least a draw
+    // so a line that can't do better than a draw is cut off before its moves are generated
+    if(ply && alpha < 0 && board->hasUpcomingRepetition(board->stateIndex - rootStateIndex)) {
+        SEARCH_STAT(stats.cycleDraws++);
+        alpha = 0;
+        if(alpha >= beta) {
+            SEARCH_STAT(stats.cycleCutoffs++);
+            TRACE_EVENT(SearchTrace::node(ply).pruning = TRACE_PRUNE_DRAW);
+            return beta;
+        }
+    }
+
     // retrieving the hashed move and evaluation if there is any
     int hashScore = transpositionTable->probeHash(depth, alpha, beta, ply);
-    if(hashScore != TranspositionTable::VAL_UNKNOWN && !isPV) return hashScore;
+    SEARCH_STAT(stats.ttProbes++);
+    if(hashScore != TranspositionTable::VAL_UNKNOWN && !isPV) {
+        SEARCH_STAT(stats.ttCutoffs++);
+        TRACE_EVENT(SearchTrace::node(ply).pruning = TRACE_PRUNE_TT);
+        return hashScore;
+    }
 
-    int moves[256];
+    Move moves[256];
     int num = board->generateLegalMoves(moves);
     if(num == 0) {
+        TRACE_EVENT(SearchTrace::node(ply).pruning = TRACE_PRUNE_NO_MOVES);
         if(isInCheck) return -mateScore; // checkmate
         return 0; // stalemate
     }
 
-    if(depth <= 0) return quiescence(alpha, beta);
+    if(depth <= 0) {
+        TRACE_EVENT(SearchTrace::node(ply).pruning = TRACE_PRUNE_HORIZON);
+        return quiescence(alpha, beta);
+    }
 
-    int currBestMove = MoveUtils::NO_MOVE;
+    Move currBestMove = MoveUtils::NO_MOVE;
 
     // --- STATIC NULL MOVE PRUNING ---
     // if our position is so good that we can afford to lose some material
@@ -254,7 +313,10 @@ int Search::alphaBeta(int alpha, int beta, short depth, short ply, bool doNull)
     int staticScore = evaluate();
     if(!isInCheck && !isPV && abs(beta) < MATE_THRESHOLD) {
         int scoreMargin = 100 * depth;
+        SEARCH_STAT(stats.staticNullTries++);
         if (staticScore - scoreMargin >= beta) {
+            SEARCH_STAT(stats.staticNullCutoffs++);
+            TRACE_EVENT(SearchTrace::node(ply).pruning = TRACE_PRUNE_STATIC_NULL);
             return staticScore - scoreMargin;
         }
     }
@@ -265,14 +327,20 @@ int Search::alphaBeta(int alpha, int beta, short depth, short ply, bool doNull)
     const int ENDGAME_MATERIAL = 4;
     if(doNull && (!isPV) && (isInCheck == false) && ply && (depth > 3) && (gamePhase() >= ENDGAME_MATERIAL) && (staticScore >= beta)) {
         board->makeMove(MoveUtils::NO_MOVE);
+        SEARCH_STAT(stats.nullTries++);
 
         short R = 3 + depth / 6;
+        TRACE_EVENT(SearchTrace::nextKind = TRACE_NULL_MOVE);
         int score = -alphaBeta(-beta, -beta + 1, depth - R - 1, ply + 1, false);
 
         board->unmakeMove(MoveUtils::NO_MOVE);
 
         if(timeOver) return 0;
-        if(score >= beta && abs(score) < MATE_THRESHOLD) return beta;
+        if(score >= beta && abs(score) < MATE_THRESHOLD) {
+            SEARCH_STAT(stats.nullCutoffs++);
+            TRACE_EVENT(SearchTrace::node(ply).pruning = TRACE_PRUNE_NULL_MOVE);
+            return beta;
+        }
     }
 
     // --- RAZORING --- 
@@ -280,16 +348,23 @@ int Search::alphaBeta(int alpha, int beta, short depth, short ply, bool doNull)
     // do a quiescence search and confirm the position will fail low
     // if qsearch score fails low we trust it and return
     if(!isPV && !isInCheck && depth <= 3 && staticScore + 250 * depth <= alpha) {
+        SEARCH_STAT(stats.razorTries++);
         int score = quiescence(alpha, beta);
-        if(score <= alpha) return score;
+        if(score <= alpha) {
+            SEARCH_STAT(stats.razorCutoffs++);
+            TRACE_EVENT(SearchTrace::node(ply).pruning = TRACE_PRUNE_RAZORING);
+            return score;
+        }
     }
 
     // --- INTERNAL ITERATIVE DEEPENING ---
     // if we don't have a move from the tt, we do a quick search with a reduced depth
     if(depth >= 4 && isPV && transpositionTable->retrieveBestMove() == MoveUtils::NO_MOVE) {
+        TRACE_EVENT(SearchTrace::nextKind = TRACE_IID);
         int score = alphaBeta(alpha, beta, depth - 2, ply + 1, doNull);
 
         // make sure we have a move in the tt
+        TRACE_EVENT(SearchTrace::nextKind = TRACE_IID);
         if (score <= alpha) score = alphaBeta(-INF, beta, depth - 2, ply + 1, doNull);
     }
 
@@ -300,15 +375,38 @@ int Search::alphaBeta(int alpha, int beta, short depth, short ply, bool doNull)
     const int F_MARGIN[5] = { 0, 100, 170, 240, 310 };
     if (depth <= 4 && !isPV && !isInCheck && abs(alpha) < Search::MATE_THRESHOLD) {
         fPrune = (staticScore + F_MARGIN[depth] <= alpha);
+        SEARCH_STAT(if(fPrune) stats.futilityNodes++);
     }
 
+    // futility pruning skips the quiet moves that don't give check, which are found before the moves are made
+    // (so the pruned moves are never made), the check info is computed when the first move needs it
+    CheckInfo ci;
+    bool hasCheckInfo = false;
+
     int movesSearched = 0;
     
     sortMoves(moves, num, ply);
     for(int idx = 0; idx < num; idx++) {
         if(alpha >= beta) return alpha;
 
+        // the move only knows its squares, so this has to be checked before it is made
+        bool isQuiet = (!board->isCapture(moves[idx]) && !MoveUtils::isPromotion(moves[idx]));
+        bool needsCheck = (isQuiet && movesSearched && fPrune);
+        if(needsCheck && !hasCheckInfo) {
+            board->checkInfo(ci);
+            hasCheckInfo = true;
+        }
+        bool givesCheck = (needsCheck && board->givesCheck(moves[idx], ci));
+
+        // Futility prune if conditions are met
+        if(movesSearched && fPrune && isQuiet && !givesCheck) {
+            SEARCH_STAT(stats.futilityPrunes++);
+            TRACE_EVENT(SearchTrace::node(ply).futilityPrunes += (SearchTrace::node(ply).futilityPrunes < 255));
+            continue;
+        }
+
         board->makeMove(moves[idx]);
+        assert(!needsCheck || givesCheck == board->isInCheck());
             
         // --- PRINCIPAL VARIATION SEARCH --- 
         // we do a full search only until we find a move that raises alpha and we consider it to be the best
@@ -316,30 +414,33 @@ int Search::alphaBeta(int alpha, int beta, short depth, short ply, bool doNull)
         // and only if the move has potential to be the best, we do a full search
         int score;
         if(!movesSearched) {
+            TRACE_EVENT(SearchTrace::nextKind = TRACE_FIRST_MOVE);
             score = -alphaBeta(-beta, -alpha, depth-1, ply+1, true);
         } else {
-            // Futility prune if conditions are met
-            if(fPrune && !MoveUtils::isCapture(moves[idx]) && !MoveUtils::isPromotion(moves[idx]) && !board->isInCheck()) {
-                board->unmakeMove(moves[idx]);
-                continue;
-            }
-
             // --- LATE MOVE REDUCTION --- 
             // we do full searches only for the first moves, and then do a reduced search
             // if the move is potentially good, we do a full search instead
-            if(movesSearched >= 2 && !MoveUtils::isCapture(moves[idx]) && !MoveUtils::isPromotion(moves[idx]) && !isInCheck && depth >= 3 && !board->isInCheck()) {
+            if(movesSearched >= 2 && isQuiet && !isInCheck && depth >= 3 && !board->isInCheck()) {
                 int reductionDepth = int(sqrt(double(depth-1)) + sqrt(double(movesSearched-1))); 
                 if(isPV) reductionDepth = (reductionDepth * 2) / 3;
                 reductionDepth = (reductionDepth < depth-1 ? reductionDepth : depth-1);
 
+                TRACE_EVENT(SearchTrace::nextKind = TRACE_LMR);
+                TRACE_EVENT(SearchTrace::nextReduction = reductionDepth);
                 score = -alphaBeta(-alpha-1, -alpha, depth - reductionDepth - 1, ply+1, true);
+                SEARCH_STAT(stats.lmrTries++);
+                SEARCH_STAT(if(score > alpha) stats.lmrResearches++);
             } else {
                 score = alpha + 1; // hack to ensure that full-depth search is done
             }
 
             if(score > alpha) {
+                TRACE_EVENT(SearchTrace::nextKind = TRACE_NULL_WINDOW);
                 score = -alphaBeta(-alpha-1, -alpha, depth-1, ply+1, true);
+                SEARCH_STAT(stats.pvsTries++);
                 if(score > alpha && score < beta) {
+                    SEARCH_STAT(stats.pvsResearches++);
+                    TRACE_EVENT(SearchTrace::nextKind = TRACE_PV_RESEARCH);
                     score = -alphaBeta(-beta, -alpha, depth-1, ply+1, true);
                 }
             }
@@ -365,9 +466,12 @@ int Search::alphaBeta(int alpha, int beta, short depth, short ply, bool doNull)
             assert(pvNextIndex < (MAX_DEPTH * MAX_DEPTH + MAX_DEPTH) / 2);
 
             if(score >= beta) {
+                SEARCH_STAT(stats.failHighs++);
+                SEARCH_STAT(if(movesSearched == 1) stats.firstMoveFailHighs++);
+                TRACE_EVENT(SearchTrace::node(ply).failHighIndex = min(movesSearched - 1, 254));
                 transpositionTable->recordHash(depth, beta, TranspositionTable::HASH_F_BETA, currBestMove, ply);
 
-                if(!MoveUtils::isCapture(moves[idx]) && !MoveUtils::isPromotion(moves[idx])) {
+                if(isQuiet) {
                     // store killer moves
                     storeKiller(ply, moves[idx]);
 
@@ -388,12 +492,17 @@ int Search::alphaBeta(int alpha, int beta, short depth, short ply, bool doNull)
     return alpha;
 }
 
-pair<int, int> Search::root() {
-    board->repetitionIndex = 0;
+pair<Move, int> Search::root() {
+    PROFILE_SCOPE(PROFILE_SEARCH);
+
     bestMove = MoveUtils::NO_MOVE;
 
     timeOver = false;
 
+    totalNodes = 0;
+    stats = SearchStats();
+    rootStateIndex = board->stateIndex;
+
     int alpha = -INF, beta = INF;
     int eval = 0;
 
@@ -412,6 +521,10 @@ pair<int, int> Search::root() {
         memset(pvArray, MoveUtils::NO_MOVE, sizeof(pvArray));
 
         int curEval = alphaBeta(alpha, beta, depth, 0, false);
+        totalNodes += nodesSearched + nodesQ;
+        stats.mainNodes += nodesSearched;
+        stats.qNodes += nodesQ;
+        stats.depthNodes[depth] += nodesSearched + nodesQ;
 
         if(timeOver) break;
 
@@ -429,13 +542,16 @@ pair<int, int> Search::root() {
         alpha = eval - ASP_INCREASE; // increase window for next iteration
         beta = eval + ASP_INCREASE;
 
-        UCI::showSearchInfo(depth, nodesSearched+nodesQ, currStartTime, eval);
+        stats.depth = depth;
+        if(showInfo) UCI::showSearchInfo(depth, nodesSearched+nodesQ, currStartTime, eval);
         currStartTime = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
 
         depth++; // increase depth only if we are inside the window
     }
 
-    int moveToPlay = bestMove;
+    lastStats = stats;
+
+    Move moveToPlay = bestMove;
     if (moveToPlay == MoveUtils::NO_MOVE) moveToPlay = transpositionTable->retrieveBestMove();
     assert(moveToPlay != MoveUtils::NO_MOVE);
 
@@ -444,7 +560,7 @@ pair<int, int> Search::root() {
 
 // --- KILLERS AND HISTORY ---
 // killer moves are quiet moves that cause a beta cutoff and are used for sorting purposes
-void Search::storeKiller(short ply, int move) {
+void Search::storeKiller(short ply, Move move) {
     // make sure the moves are different
     if(killerMoves[ply][0] != move) 
         killerMoves[ply][1] = killerMoves[ply][0];
@@ -454,10 +570,11 @@ void Search::storeKiller(short ply, int move) {
 
 
 // same as killer moves, but they are saved based on their squares and color
-void Search::updateHistory(int move, int depth) {
+void Search::updateHistory(Move move, int depth) {
     int bonus = depth * depth;
+    int *entry = &history[board->squares[MoveUtils::getFromSq(move)]][MoveUtils::getToSq(move)];
 
-    history[(MoveUtils::getColor(move) | MoveUtils::getPiece(move))][MoveUtils::getToSq(move)] += 2 * bonus;
+    *entry += 2 * bonus;
     for(int pc = 0; pc < 16; pc++) {
         for(int sq = 0; sq < 64; sq++) {
             history[pc][sq] = max(0, history[pc][sq] - bonus);
@@ -465,7 +582,7 @@ void Search::updateHistory(int move, int depth) {
     }
 
     // cap history points at HISTORY_MAX
-    if(history[(MoveUtils::getColor(move) | MoveUtils::getPiece(move))][MoveUtils::getToSq(move)] > HISTORY_MAX) {
+    if(*entry > HISTORY_MAX) {
         for(int pc = 0; pc < 16; pc++) {
             for(int sq = 0; sq < 64; sq++) {
                 history[pc][sq] /= 2;
@@ -491,7 +608,7 @@ void Search::ageHistory() {
 }
 
 // --- PV HELPER FUNCTIONS ---
-void Search::copyPv(int* dest, const int* src, int n) {
+void Search::copyPv(Move* dest, const Move* src, int n) {
    while (n-- && (*dest++ = *src++));
    *dest = MoveUtils::NO_MOVE;
 }
@@ -3,42 +3,76 @@
 #ifndef SEARCH_H_
 #define SEARCH_H_
 
+#include "MoveUtils.h"
+
 using namespace std;
 
+// search statistics are only collected if this is 1, otherwise SEARCH_STAT(x) compiles to nothing
+#ifndef SEARCH_STATS
+#define SEARCH_STATS 0
+#endif
+
+#if SEARCH_STATS
+#define SEARCH_STAT(x) x
+#else
+#define SEARCH_STAT(x)
+#endif
+
+// counters of a search, summed over all of its iterations
+struct SearchStats {
+    long long mainNodes, qNodes;
+    long long ttProbes, ttHits, ttCutoffs; // hits are probes that found the position, cutoffs are the ones that returned a score
+    long long failHighs, firstMoveFailHighs; // beta cutoffs of the main search and the ones caused by the first move
+    long long cycleDraws, cycleCutoffs; // nodes where a repetition could be forced and the ones it cut off
+    long long staticNullTries, staticNullCutoffs;
+    long long nullTries, nullCutoffs;
+    long long razorTries, razorCutoffs;
+    long long futilityNodes, futilityPrunes; // nodes where futility pruning is on and the quiet moves it skipped
+    long long lmrTries, lmrResearches; // reduced searches and the ones that beat alpha and were searched again
+    long long pvsTries, pvsResearches; // null window searches and the ones that needed a full window
+    long long lazyEvalCalls, lazyEvalExits; // quiescence evaluations and the ones that skipped the positional terms
+    int maxPositionalScore; // largest positional term of the full evaluations, should stay below the lazy margin
+    long long depthNodes[101]; // nodes of every iteration (indexed by depth), aspiration re-searches included
+    int selDepth;
+    short depth; // last completed iteration
+};
+
 class Search {
 private:
-    static int bestMove;
+    static Move bestMove;
 
-    static int killerMoves[256][2];
+    static Move killerMoves[256][2];
     static int history[16][64];
     static const int HISTORY_MAX;
 
     static const int INF;
 
-    static int nodesSearched;
-    static int nodesQ;
+    static long long nodesSearched;
+    static long long nodesQ;
+
+    static Move pvArray[];
 
-    static int pvArray[];
+    static int rootStateIndex;
 
     static const int ASP_INCREASE;
 
     // --- MOVE ORDERING ---
-    static int captureScore(int move);
-    static int nonCaptureScore(int move);
-    static bool cmpCapturesInv(int a, int b);
-    static bool cmpCaptures(int a, int b);
-    static bool cmpNonCaptures(int a, int b);
-    static void sortMoves(int *moves, int num, short ply);
+    static int captureScore(Move move);
+    static int nonCaptureScore(Move move);
+    static bool cmpScoredMovesInv(const ScoredMove& a, const ScoredMove& b);
+    static bool cmpScoredMoves(const ScoredMove& a, const ScoredMove& b);
+    static void sortMoves(Move *moves, int num, short ply);
 
     static int alphaBeta(int alpha, int beta, short depth, short ply, bool doNull);
+    static int alphaBetaNode(int alpha, int beta, short depth, short ply, bool doNull);
 
     // --- KILLERS AND HISTORY ---
-    static void storeKiller(short ply, int move);
-    static void updateHistory(int move, int depth);
+    static void storeKiller(short ply, Move move);
+    static void updateHistory(Move move, int depth);
     static void ageHistory();
 
     // --- PV HELPER FUNCTIONS ---
-    static void copyPv(int* dest, const int* src, int n);
+    static void copyPv(Move* dest, const Move* src, int n);
 public:
 
     static const int MATE_EVAL;
@@ -50,7 +84,13 @@ public:
     static bool infiniteTime;
     static bool timeOver;
 
-    static pair<int, int> root();
+    static long long totalNodes; // nodes of the last search, all the iterations included
+    static bool showInfo; // print the info lines while searching
+
+    static SearchStats stats; // counters of the current search
+    static SearchStats lastStats; // counters of the last finished search
+
+    static pair<Move, int> root();
     static int quiescence(int alpha, int beta);
     static void clearHistory();
     static void showPV(int depth);
@@ -0,0 +1,134 @@
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "SearchTrace.h"
+
+using namespace std;
+
+#if SEARCH_TRACE
+
+static const int BUFFER_RECORDS = (1 << 15); // 1 MB per buffer
+
+// the search fills buffers[current], the writer thread writes the buffers that are marked as full
+static TraceRecord buffers[2][BUFFER_RECORDS];
+static bool bufferFull[2];
+static int current = 0, used = 0;
+static long long written = 0, dropped = 0;
+
+static FILE *traceFile = nullptr;
+static thread writer;
+static mutex writerMutex;
+static condition_variable writerCv;
+static bool stopWriter = false;
+
+TraceRecord SearchTrace::stack[SearchTrace::MAX_PLY];
+uint32_t SearchTrace::nextId = 0;
+bool SearchTrace::active = false;
+uint8_t SearchTrace::nextKind = TRACE_ROOT;
+uint8_t SearchTrace::nextReduction = 0;
+
+static void writeBuffers() {
+    unique_lock<mutex> lk(writerMutex);
+    while(true) {
+        writerCv.wait(lk, []{ return stopWriter || bufferFull[0] || bufferFull[1]; });
+
+        for(int b = 0; b < 2; b++) {
+            if(!bufferFull[b]) continue;
+
+            lk.unlock();
+            fwrite(buffers[b], sizeof(TraceRecord), BUFFER_RECORDS, traceFile);
+            lk.lock();
+            bufferFull[b] = false;
+        }
+
+        if(stopWriter) return;
+    }
+}
+
+bool SearchTrace::open(const string &fileName) {
+    close();
+
+    traceFile = fopen(fileName.c_str(), "wb");
+    if(traceFile == nullptr) return false;
+    fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), traceFile);
+
+    current = used = 0;
+    written = dropped = 0;
+    bufferFull[0] = bufferFull[1] = stopWriter = false;
+    nextId = 0;
+    nextKind = TRACE_ROOT;
+
+    writer = thread(writeBuffers);
+    active = true;
+    return true;
+}
+
+void SearchTrace::close() {
+    if(!active) return;
+    active = false;
+
+    {
+        lock_guard<mutex> lk(writerMutex);
+        stopWriter = true;
+    }
+    writerCv.notify_one();
+    writer.join();
+
+    // the partly filled buffer is written here, once the writer is done
+    fwrite(buffers[current], sizeof(TraceRecord), used, traceFile);
+    fclose(traceFile);
+    traceFile = nullptr;
+
+    cout << "info string trace closed, " << written << " nodes written, " << dropped << " dropped\n";
+    cout.flush();
+}
+
+// hands the current buffer to the writer, or drops it if the other one hasn't been written yet
+void SearchTrace::flushBuffer() {
+    {
+        lock_guard<mutex> lk(writerMutex);
+        if(bufferFull[current ^ 1]) {
+            dropped += used;
+            written -= used;
+            used = 0;
+            return;
+        }
+        bufferFull[current] = true;
+    }
+    writerCv.notify_one();
+
+    current ^= 1;
+    used = 0;
+}
+
+void SearchTrace::enter(int ply, int depth, int alpha, int beta, uint16_t move) {
+    TraceRecord &r = stack[ply];
+    r.id = ++nextId;
+    r.parent = (ply ? stack[ply-1].id : 0);
+    r.alpha = alpha;
+    r.beta = beta;
+    r.score = 0;
+    r.move = move;
+    r.ply = ply;
+    r.depth = depth;
+    r.isPV = (beta - alpha > 1);
+    r.kind = (ply ? nextKind : (uint8_t)TRACE_ROOT);
+    r.pruning = TRACE_PRUNE_NONE;
+    r.failHighIndex = 255;
+    r.futilityPrunes = 0;
+    r.reduction = (r.kind == TRACE_LMR ? nextReduction : 0);
+    r.unused = 0;
+}
+
+void SearchTrace::leave(int ply, int score) {
+    stack[ply].score = score;
+
+    buffers[current][used++] = stack[ply];
+    written++;
+    if(used == BUFFER_RECORDS) flushBuffer();
+}
+
+#endif
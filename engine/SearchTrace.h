@@ -0,0 +1,92 @@
+#pragma once
+
+#ifndef SEARCHTRACE_H_
+#define SEARCHTRACE_H_
+
+#include <cstdint>
+#include <string>
+
+// the nodes of the main search are written to a trace file if this is 1, otherwise TRACE_EVENT(x) compiles to nothing
+#ifndef SEARCH_TRACE
+#define SEARCH_TRACE 0
+#endif
+
+#if SEARCH_TRACE
+#define TRACE_EVENT(x) x
+#else
+#define TRACE_EVENT(x)
+#endif
+
+// how the parent searched the node
+enum TraceKind : uint8_t {
+    TRACE_ROOT,
+    TRACE_FIRST_MOVE, // full window, full depth
+    TRACE_LMR, // reduced depth, null window
+    TRACE_NULL_WINDOW, // full depth, null window (after a reduced search that beat alpha, or without a reduction)
+    TRACE_PV_RESEARCH, // full window, after a null window search that landed inside the window
+    TRACE_NULL_MOVE,
+    TRACE_IID
+};
+
+// what ended the node before its moves were searched
+enum TracePruning : uint8_t {
+    TRACE_PRUNE_NONE,
+    TRACE_PRUNE_MATE_DISTANCE,
+    TRACE_PRUNE_DRAW,
+    TRACE_PRUNE_TT,
+    TRACE_PRUNE_NO_MOVES, // checkmate or stalemate
+    TRACE_PRUNE_HORIZON, // depth 0, the score comes from the quiescence search
+    TRACE_PRUNE_STATIC_NULL,
+    TRACE_PRUNE_NULL_MOVE,
+    TRACE_PRUNE_RAZORING,
+    TRACE_PRUNES
+};
+
+// one node, written when the search of the node ends (so the children of a node come before it)
+// the window and the score are relative to the side to move in the node
+struct TraceRecord {
+    uint32_t id, parent; // ids start from 1, the parent of the root is 0
+    int32_t alpha, beta, score;
+    uint16_t move; // the move that leads to the node
+    uint8_t ply;
+    int8_t depth;
+    uint8_t isPV;
+    uint8_t kind; // TraceKind
+    uint8_t pruning; // TracePruning
+    uint8_t failHighIndex; // index of the move that failed high, 255 if none did
+    uint8_t futilityPrunes; // moves skipped by futility pruning (at most 255)
+    uint8_t reduction; // the lmr reduction of a TRACE_LMR node
+    uint16_t unused;
+};
+
+static_assert(sizeof(TraceRecord) == 32, "trace records have to be 32 bytes");
+
+static const char TRACE_MAGIC[8] = {'C', 'I', 'O', 'T', 'R', 'A', 'C', '1'};
+
+#if SEARCH_TRACE
+
+// ---search trace---
+// the records are collected in one of two buffers, a full buffer is written to the file by a separate thread
+// if that thread falls behind, the records are dropped (and counted) instead of stalling the search
+class SearchTrace {
+private:
+    static const int MAX_PLY = 128;
+    static TraceRecord stack[MAX_PLY]; // the nodes that are being searched, indexed by ply
+    static uint32_t nextId;
+
+    static void flushBuffer();
+public:
+    static bool active;
+    static uint8_t nextKind, nextReduction; // set by the parent before searching a child
+
+    static bool open(const std::string &fileName);
+    static void close();
+
+    static void enter(int ply, int depth, int alpha, int beta, uint16_t move);
+    static void leave(int ply, int score);
+    static inline TraceRecord &node(int ply) { return stack[ply]; }
+};
+
+#endif
+
+#endif
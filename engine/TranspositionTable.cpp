@@ -2,6 +2,7 @@
 #include <vector>
 #include <unordered_map>
 #include <cassert>
+#include <algorithm>
 
 #include "Board.h"
 #include "TranspositionTable.h"
@@ -10,6 +11,7 @@
 #include "MoveUtils.h"
 #include "BoardUtils.h"
 #include "Enums.h"
+#include "Profiler.h"
 
 using namespace std;
 
@@ -19,6 +21,9 @@ U64 TranspositionTable::pieceZobristNumbers[7][2][64];
 U64 TranspositionTable::castleZobristNumbers[16];
 U64 TranspositionTable::epZobristNumbers[8];
 U64 TranspositionTable::blackTurnZobristNumber;
+U64 TranspositionTable::materialZobristNumbers[7][2][16];
+U64 TranspositionTable::cuckooKeys[CUCKOO_SIZE];
+Move TranspositionTable::cuckooMoves[CUCKOO_SIZE];
 
 const int TranspositionTable::VAL_UNKNOWN = -1e9;
 const int TranspositionTable::HASH_F_EXACT = 0;
@@ -26,23 +31,28 @@ const int TranspositionTable::HASH_F_ALPHA = 1;
 const int TranspositionTable::HASH_F_BETA = 2;
 const int TranspositionTable::HASH_F_UNKNOWN = -1;
 
+// 16 bytes, the move only takes 16 bits and the depth and flags fit in a byte each
 struct TranspositionTable::hashElement {
     U64 key;
-    short depth;
-    int flags;
     int value;
-    int best;
+    Move best;
+    int8_t depth;
+    int8_t flags;
 };
 
-TranspositionTable::TranspositionTable(): SIZE(1 << 22), hashTable(new hashElement*[SIZE]) {
-    for(int i = 0; i < SIZE; i++) {
-        hashTable[i] = new hashElement[2];
-    }
+// the number of buckets (2 elements of 16 bytes each) is the largest power of 2 that fits in the given size
+static int bucketsFor(int sizeMB) {
+    U64 bytes = ((U64)max(sizeMB, 1) << 20), buckets = 1;
+    while(2 * buckets * 32 <= bytes && buckets < (1ULL << 30)) buckets *= 2;
+    return (int)buckets;
+}
+
+// one contiguous array, so the table takes the given size and nothing more
+TranspositionTable::TranspositionTable(int sizeMB): SIZE(bucketsFor(sizeMB)), hashTable(new hashElement[2 * (size_t)SIZE]) {
     clear();
 }
 
 TranspositionTable::~TranspositionTable() {
-    for(int i = 0; i < SIZE; i++) delete[] hashTable[i];
     delete[] hashTable;
 }
 
@@ -61,14 +71,62 @@ void TranspositionTable::generateZobristHashNumbers() {
         TranspositionTable::epZobristNumbers[col] = MagicBitboardUtils::randomULL();
     }
     TranspositionTable::blackTurnZobristNumber = MagicBitboardUtils::randomULL();
+
+    // material keys use one number for every (piece, color, count) triplet
+    for(int pc = 0; pc < 7; pc++) {
+        for(int c = 0; c < 2; c++) {
+            for(int cnt = 0; cnt < 16; cnt++) {
+                TranspositionTable::materialZobristNumbers[pc][c][cnt] = MagicBitboardUtils::randomULL();
+            }
+        }
+    }
+}
+
+// every move of a knight, bishop, rook, queen or king between two squares (either way, either color) is inserted
+// with the key pieces[from] ^ pieces[to] ^ turn, which is the hash difference between two positions it connects
+void TranspositionTable::generateCuckooTables() {
+    fill(cuckooKeys, cuckooKeys + CUCKOO_SIZE, 0ULL);
+    fill(cuckooMoves, cuckooMoves + CUCKOO_SIZE, MoveUtils::NO_MOVE);
+
+    int count = 0;
+    for(int pc = Knight; pc <= King; pc++) {
+        for(int c = 0; c < 2; c++) {
+            for(int s1 = 0; s1 < 64; s1++) {
+                U64 attacksBB = 0;
+                if(pc == Knight) attacksBB = BoardUtils::knightAttacksBB[s1];
+                if(pc == King) attacksBB = BoardUtils::kingAttacksBB[s1];
+                if(pc == Bishop || pc == Queen) attacksBB |= MagicBitboardUtils::magicBishopAttacks(0, s1);
+                if(pc == Rook || pc == Queen) attacksBB |= MagicBitboardUtils::magicRookAttacks(0, s1);
+
+                for(int s2 = s1 + 1; s2 < 64; s2++) {
+                    if(!(attacksBB & BoardUtils::bits[s2])) continue;
+
+                    U64 key = (pieceZobristNumbers[pc][c][s1] ^ pieceZobristNumbers[pc][c][s2] ^ blackTurnZobristNumber);
+                    Move move = MoveUtils::getMove(s1, s2);
+
+                    // cuckoo insertion: take the first slot and push its previous entry to its other slot, until one is empty
+                    int i = cuckooH1(key);
+                    while(true) {
+                        swap(cuckooKeys[i], key);
+                        swap(cuckooMoves[i], move);
+                        if(move == MoveUtils::NO_MOVE) break;
+                        i = (i == cuckooH1(key) ? cuckooH2(key) : cuckooH1(key));
+                    }
+                    count++;
+                }
+            }
+        }
+    }
+
+    assert(count == 3668);
 }
 
 // get the best move from the tt
-int TranspositionTable::retrieveBestMove() {
+Move TranspositionTable::retrieveBestMove() {
     int index = (board->hashKey & (SIZE-1));
     assert(index >= 0 && index < SIZE);
 
-    hashElement *h = hashTable[index];
+    hashElement *h = hashTable + 2 * (size_t)index;
 
     if(h[0].key == board->hashKey && h[0].best != MoveUtils::NO_MOVE) return h[0].best;
     if(h[1].key == board->hashKey) return h[1].best;
@@ -76,22 +134,22 @@ int TranspositionTable::retrieveBestMove() {
     return MoveUtils::NO_MOVE;
 }
 
-int TranspositionTable::retrieveDepthMove() {
+Move TranspositionTable::retrieveDepthMove() {
     int index = (board->hashKey & (SIZE-1));
     assert(index >= 0 && index < SIZE);
 
-    hashElement *h = hashTable[index];
+    hashElement *h = hashTable + 2 * (size_t)index;
 
     if(h[0].key == board->hashKey) return h[0].best;
 
     return MoveUtils::NO_MOVE;
 }
 
-int TranspositionTable::retrieveReplaceMove() {
+Move TranspositionTable::retrieveReplaceMove() {
     int index = (board->hashKey & (SIZE-1));
     assert(index >= 0 && index < SIZE);
 
-    hashElement *h = hashTable[index];
+    hashElement *h = hashTable + 2 * (size_t)index;
 
     if(h[1].key == board->hashKey) return h[1].best;
 
@@ -100,10 +158,13 @@ int TranspositionTable::retrieveReplaceMove() {
 
 // check if the stored hash element corresponds to the current position and if it was searched at a good enough depth
 int TranspositionTable::probeHash(short depth, int alpha, int beta, int ply) {
+    PROFILE_SCOPE(PROFILE_PROBE_HASH);
+
     int index = (board->hashKey & (SIZE-1));
     assert(index >= 0 && index < SIZE);
 
-    hashElement *h = hashTable[index];
+    hashElement *h = hashTable + 2 * (size_t)index;
+    SEARCH_STAT(if(h[0].key == board->hashKey || h[1].key == board->hashKey) Search::stats.ttHits++);
 
     for(int i = 0; i < 2; i++) {
         if(h[i].key == board->hashKey) {
@@ -127,13 +188,15 @@ int TranspositionTable::probeHash(short depth, int alpha, int beta, int ply) {
 }
 
 // replace hashed element if replacement conditions are met
-void TranspositionTable::recordHash(short depth, int val, int hashF, int best, int ply) {
+void TranspositionTable::recordHash(short depth, int val, int hashF, Move best, int ply) {
+    PROFILE_SCOPE(PROFILE_RECORD_HASH);
+
     if(Search::timeOver) return;
 
     int index = (board->hashKey & (SIZE-1));
     assert(index >= 0 && index < SIZE);
 
-    hashElement *h = hashTable[index];
+    hashElement *h = hashTable + 2 * (size_t)index;
 
     // current score is relative to the root position
     // we want to store it relative to the current position
@@ -158,11 +221,24 @@ void TranspositionTable::recordHash(short depth, int val, int hashF, int best, i
     h[1].depth = depth;
 }
 
+// permille of the elements in use, estimated from the first 500 buckets
+int TranspositionTable::hashfull() {
+    int used = 0;
+    for(int i = 0; i < min(SIZE, 500); i++)
+        used += (hashTable[2*i].flags != HASH_F_UNKNOWN) + (hashTable[2*i+1].flags != HASH_F_UNKNOWN);
+
+    return used * 1000 / (2 * min(SIZE, 500));
+}
+
 void TranspositionTable::clear() {
-    hashElement newElement = {0, -2, HASH_F_UNKNOWN, 0, MoveUtils::NO_MOVE};
-    for(int i = 0; i < SIZE; i++) {
-        hashTable[i][0] = hashTable[i][1] = newElement;
-    }
+    hashElement newElement;
+    newElement.key = 0;
+    newElement.value = 0;
+    newElement.best = MoveUtils::NO_MOVE;
+    newElement.depth = -2;
+    newElement.flags = HASH_F_UNKNOWN;
+
+    fill(hashTable, hashTable + 2 * (size_t)SIZE, newElement);
 }
 
 TranspositionTable *transpositionTable = nullptr;
\ No newline at end of file
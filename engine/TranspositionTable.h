@@ -3,32 +3,45 @@
 #ifndef TRANSPOSITIONTABLE_H_
 #define TRANSPOSITIONTABLE_H_
 
+#include "MoveUtils.h"
+
 class TranspositionTable {
 private:
     const int SIZE;
     struct hashElement;
-    hashElement **hashTable;
+    hashElement *hashTable; // SIZE buckets of 2 elements, one after the other
 public:
-    TranspositionTable();
+    TranspositionTable(int sizeMB = 128);
     ~TranspositionTable();
 
     static U64 pieceZobristNumbers[7][2][64];
     static U64 castleZobristNumbers[16];
     static U64 epZobristNumbers[8];
     static U64 blackTurnZobristNumber;
+    static U64 materialZobristNumbers[7][2][16];
+
+    // cuckoo tables of the reversible piece moves (keyed by the hash difference they make, side to move included),
+    // every key is in one of its two slots so a hash difference can be looked up with two probes
+    static const int CUCKOO_SIZE = 8192;
+    static U64 cuckooKeys[CUCKOO_SIZE];
+    static Move cuckooMoves[CUCKOO_SIZE];
+    inline static int cuckooH1(U64 key) { return (key & (CUCKOO_SIZE-1)); }
+    inline static int cuckooH2(U64 key) { return ((key >> 16) & (CUCKOO_SIZE-1)); }
 
     static const int VAL_UNKNOWN;
     static const int HASH_F_ALPHA, HASH_F_BETA, HASH_F_EXACT, HASH_F_UNKNOWN;
 
-    int retrieveBestMove();
-    int retrieveDepthMove();
-    int retrieveReplaceMove();
+    Move retrieveBestMove();
+    Move retrieveDepthMove();
+    Move retrieveReplaceMove();
     
     int probeHash(short depth, int alpha, int beta, int ply);
-    void recordHash(short depth, int val, int hashF, int best, int ply);
+    void recordHash(short depth, int val, int hashF, Move best, int ply);
     void clear();
+    int hashfull();
 
     static void generateZobristHashNumbers();
+    static void generateCuckooTables();
 };
 
 extern TranspositionTable *transpositionTable;
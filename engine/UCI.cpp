@@ -2,19 +2,28 @@
 #include <string>
 #include <iostream>
 #include <chrono>
+#include <iomanip>
 #include <unordered_map>
 #include <mutex>
 #include <condition_variable>
+#include <thread>
 
 #include "Board.h"
 #include "Search.h"
 #include "Evaluate.h"
 #include "TranspositionTable.h"
 #include "BoardUtils.h"
+#include "MagicBitboardUtils.h"
+#include "NNUE.h"
+#include "Perft.h"
 #include "Enums.h"
 #include "UCI.h"
+#include "Profiler.h"
+#include "SearchTrace.h"
+#include "Cpu.h"
 
 string UCI::engineName = "CiorapBot 0.3";
+const short UCI::BENCH_DEPTH = 8;
 string UCI::goCommand;
 std::condition_variable UCI::cv;
 std::mutex UCI::mtx;
@@ -55,6 +64,8 @@ void UCI::UCICommunication() {
             inputUCINewGame();
         } else if(inputString.substr(0, 8) == "position") {
             inputPosition(inputString);
+        } else if(inputString.substr(0, 9) == "setoption") {
+            inputSetOption(inputString);
         } else if(inputString.substr(0, 2) == "go") {
             {
                 std::lock_guard<std::mutex> lk(UCI::mtx);
@@ -66,6 +77,39 @@ void UCI::UCICommunication() {
             printBoard(inputString.length() <= 6 || inputString.substr(6, 3) != "num");
         } else if(inputString.substr(0, 4) == "eval") {
             printEval();
+        } else if(inputString.substr(0, 11) == "sliderbench") {
+            vector<string> parsedInput = splitStr(inputString);
+            sliderBench(parsedInput.size() > 1 ? stoi(parsedInput[1]) : 6);
+        } else if(inputString.substr(0, 9) == "makebench") {
+            vector<string> parsedInput = splitStr(inputString);
+            makeBench(parsedInput.size() > 1 ? stoi(parsedInput[1]) : 4);
+        } else if(inputString.substr(0, 5) == "bench") {
+            vector<string> parsedInput = splitStr(inputString);
+            bench(parsedInput.size() > 1 ? stoi(parsedInput[1]) : BENCH_DEPTH,
+                  parsedInput.size() > 2 ? stoi(parsedInput[2]) : 16,
+                  parsedInput.size() > 3 ? stoi(parsedInput[3]) : 1);
+        } else if(inputString.substr(0, 7) == "profile") {
+#if PROFILE
+            if(inputString == "profile clear") Profiler::clear();
+            else Profiler::print();
+#else
+            std::cout << "info string profiling is disabled, build with -DPROFILE=1\n";
+#endif
+        } else if(inputString.substr(0, 5) == "trace") {
+            // trace <file> writes the nodes of the next searches to the file, trace off closes it
+            vector<string> parsedInput = splitStr(inputString);
+#if SEARCH_TRACE
+            if(parsedInput.size() < 2 || parsedInput[1] == "off") SearchTrace::close();
+            else if(!SearchTrace::open(parsedInput[1])) std::cout << "info string could not open " << parsedInput[1] << '\n';
+#else
+            std::cout << "info string search tracing is disabled, build with -DSEARCH_TRACE=1\n";
+#endif
+        } else if(inputString == "stats") {
+            printStats();
+        } else if(inputString.substr(0, 10) == "perftsuite") {
+            vector<string> parsedInput = splitStr(inputString);
+            if(parsedInput.size() < 2) std::cout << "info string usage: perftsuite <file.epd> [max depth]\n";
+            else Perft::runSuite(parsedInput[1], parsedInput.size() > 2 ? stoi(parsedInput[2]) : 100, max(1, (int)thread::hardware_concurrency()));
         } else if(inputString == "stop") {
             Search::timeOver = true;
         } else if(inputString == "quit") {
@@ -84,6 +128,10 @@ void UCI::UCICommunication() {
 void UCI::inputUCI() {
     std::cout << "id name " << engineName << '\n';
     std::cout << "id author Vlad Ciocoiu\n";
+    std::cout << "option name UseNNUE type check default false\n";
+    std::cout << "option name EvalFile type string default " << NNUE::evalFile << '\n';
+    std::cout << "option name SliderAttacks type combo default " << (MagicBitboardUtils::usePext ? "pext" : "magic") << " var magic var pext\n";
+    std::cout << "info string cpu " << Cpu::variant() << '\n';
     std::cout << "uciok\n";
 }
 
@@ -112,34 +160,63 @@ void UCI::inputPosition(string input) {
         board->loadFenPos("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
         movesIdx = 2;
     } else {
+        // the fen ends at the moves (the move counters are optional)
         string fen;
-        for(int i = 2; i <= 5; i++)
-            fen += parsedInput[i] + " ";
-        
-        if(parsedInput.size() > 6) fen += parsedInput[6] + " ";
-        if(parsedInput.size() > 7) fen += parsedInput[7] + " ";
-        
+        for(movesIdx = 2; movesIdx < (int)parsedInput.size() && parsedInput[movesIdx] != "moves"; movesIdx++)
+            fen += parsedInput[movesIdx] + " ";
+
         board->loadFenPos(fen);
-        movesIdx = 8;
     }
 
     // make the moves
     for(unsigned int i = movesIdx+1; i < parsedInput.size(); i++) {
-        int moves[256];
+        Move moves[256];
         int num = board->generateLegalMoves(moves);
         for(int idx = 0; idx < num; idx++) 
             if(BoardUtils::moveToString(moves[idx]) == parsedInput[i]) {
                 board->makeMove(moves[idx]);
                 break;
             }
+
+        // long games would fill the stacks otherwise
+        board->dropOldStates();
     }
 }
 
+// setoption name <name> value <value>
+void UCI::inputSetOption(string input) {
+    vector<string> parsedInput = splitStr(input);
+    if(parsedInput.size() < 5 || parsedInput[1] != "name" || parsedInput[3] != "value") return;
+
+    string name = parsedInput[2];
+
+    // the value is everything after "value", so file paths can contain spaces
+    string value = parsedInput[4];
+    for(unsigned int i = 5; i < parsedInput.size(); i++) value += " " + parsedInput[i];
+
+    if(name == "EvalFile") {
+        NNUE::evalFile = value;
+        if(NNUE::useNNUE && !NNUE::loadNetwork(NNUE::evalFile))
+            std::cout << "info string could not load network " << NNUE::evalFile << '\n';
+    } else if(name == "UseNNUE") {
+        NNUE::useNNUE = (value == "true");
+        if(NNUE::useNNUE && !NNUE::isActive() && !NNUE::loadNetwork(NNUE::evalFile))
+            std::cout << "info string could not load network " << NNUE::evalFile << ", using the classical evaluation\n";
+    } else if(name == "SliderAttacks") {
+        if(!MagicBitboardUtils::setBackend(value == "pext"))
+            std::cout << "info string pext is not available on this cpu, using magics\n";
+        return;
+    } else return;
+
+    // the accumulator is only maintained while nnue is active
+    if(board != nullptr && NNUE::isActive()) board->refreshAccumulator();
+}
+
 // perft function that returns the number of positions reached from an initial position after a certain depth
 long long UCI::moveGenTest(short depth, bool show) {
     if(depth == 0) return 1;
 
-    int moves[256];
+    Move moves[256];
     int num = board->generateLegalMoves(moves);
 
     if(depth == 1) return num;
@@ -159,23 +236,250 @@ long long UCI::moveGenTest(short depth, bool show) {
     return numPos;
 }
 
+// slider lookup throughput and perft speed of every available attack backend, from the current position
+void UCI::sliderBench(short depth) {
+    bool usedPext = MagicBitboardUtils::usePext;
+
+    // the same random occupancies are looked up with every backend
+    const int NUM_OCC = 4096, ROUNDS = 4096;
+    vector<U64> occupancies(NUM_OCC);
+    for(U64& occ: occupancies) occ = (MagicBitboardUtils::randomULL() & MagicBitboardUtils::randomULL());
+
+    for(bool pext: {false, true}) {
+        string name = (pext ? "pext" : "magic");
+        if(!MagicBitboardUtils::setBackend(pext)) {
+            std::cout << "info string " << name << " is not available on this cpu\n";
+            continue;
+        }
+
+        // the lookups only depend on the occupancies, so this measures throughput rather than latency
+        U64 checksum = 0;
+        long long startTime = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+        for(int r = 0; r < ROUNDS; r++) {
+            for(int i = 0; i < NUM_OCC; i++) {
+                int sq = ((i + r) & 63);
+                checksum += MagicBitboardUtils::magicRookAttacks(occupancies[i], sq);
+                checksum += MagicBitboardUtils::magicBishopAttacks(occupancies[i], sq);
+            }
+        }
+        long long lookupTime = max(1LL, chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count() - startTime);
+        long long lookups = 2LL * NUM_OCC * ROUNDS;
+
+        startTime = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+        long long nodes = moveGenTest(depth, false);
+        long long perftTime = max(1LL, chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count() - startTime);
+
+        std::cout << name << ": lookups " << lookups << " time " << lookupTime << " lps " << 1000LL*lookups/lookupTime
+                  << " checksum " << checksum << " | perft " << depth << " nodes " << nodes << " time " << perftTime
+                  << " nps " << 1000LL*nodes/perftTime << '\n';
+    }
+
+    MagicBitboardUtils::setBackend(usedPext);
+}
+
+// makes and unmakes every move in the perft tree of the current position, each one repeat times
+// returns the number of make/unmake pairs
+long long UCI::makeUnmakeTest(short depth, int repeat) {
+    if(depth == 0) return 0;
+
+    Move moves[256];
+    int num = board->generateLegalMoves(moves);
+
+    long long pairs = 0;
+    for(int idx = 0; idx < num; idx++) {
+        for(int r = 1; r < repeat; r++) {
+            board->makeMove(moves[idx]);
+            board->unmakeMove(moves[idx]);
+        }
+
+        board->makeMove(moves[idx]);
+        pairs += repeat + makeUnmakeTest(depth-1, repeat);
+        board->unmakeMove(moves[idx]);
+    }
+    return pairs;
+}
+
+// make/unmake throughput from the current position
+// the moves are repeated so that the move generation of the tree is only a small part of the time
+void UCI::makeBench(short depth) {
+    const int REPEAT = 16;
+
+    long long startTime = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    long long pairs = makeUnmakeTest(depth, REPEAT);
+    long long time = max(1LL, chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count() - startTime);
+
+    std::cout << "makebench " << depth << " (" << (COPY_MAKE ? "copy-make" : "make/unmake") << "): make/unmake pairs " << pairs << " time " << time << " pairs/s " << 1000LL*pairs/time << '\n';
+}
+
+// positions of the bench command: openings, middlegames and endgames, including some with few legal moves
+static const vector<string> benchFens = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/8 b - - 3 54",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+    "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+    "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+    "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+    "5rk1/q6p/2p3bR/1pPp1rP1/1P1Pp3/P3B1Q1/1K3P2/R7 w - - 93 90",
+    "4rrk1/1p1nq3/p7/2p1P1pp/3P2bp/3Q1Bn1/PPPB4/1K2R1NR w - - 40 21",
+    "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+    "3Qb1k1/1r2ppb1/pN1n2q1/Pp1Pp1Pr/4P2p/4BP2/4B1R1/1R5K b - - 11 40",
+    "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 5 1",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+    "rnbqkb1r/pp1p1ppp/4pn2/2p5/2PP4/2N5/PP2PPPP/R1BQKBNR w KQkq - 0 4",
+    "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1",
+    "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+    "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+    "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+    "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+    "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+    "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+    "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+    "8/8/8/8/8/4k3/4P3/4K3 w - - 0 1",
+    "8/8/8/3k4/8/8/8/KBN5 w - - 0 1",
+    "8/8/8/8/8/6k1/6p1/6K1 b - - 0 1",
+    "7k/8/6KP/8/8/8/3B4/8 w - - 0 1"
+};
+
+// searches every bench position to a fixed depth, with cleared tables
+// the total number of nodes only changes when the search does, so it can be used as a signature of the search
+void UCI::bench(short depth, int hashMB, int threads) {
+    if(threads > 1) std::cout << "info string the search is single threaded, bench uses 1 thread\n";
+
+    // the bench uses its own board and hash table, the ones of the game are put back at the end
+    Board *gameBoard = board;
+    TranspositionTable *gameTable = transpositionTable;
+    board = new Board();
+    transpositionTable = new TranspositionTable(hashMB);
+
+    Search::showInfo = false;
+    Search::infiniteTime = true;
+    Search::currMaxDepth = depth;
+
+    long long nodes = 0;
+    long long startTime = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    for(unsigned int i = 0; i < benchFens.size(); i++) {
+        board->loadFenPos(benchFens[i]);
+        transpositionTable->clear();
+        Search::clearHistory();
+
+        Search::root();
+        nodes += Search::totalNodes;
+        std::cout << "position " << i+1 << "/" << benchFens.size() << " nodes " << Search::totalNodes << '\n';
+    }
+    long long time = max(1LL, chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count() - startTime);
+
+    Search::showInfo = true;
+    delete board;
+    delete transpositionTable;
+    board = gameBoard;
+    transpositionTable = gameTable;
+
+    std::cout << "bench depth " << depth << " hash " << hashMB << " threads 1\n";
+    std::cout << "nodes " << nodes << " time " << time << " nps " << 1000LL*nodes/time << '\n';
+    std::cout.flush();
+}
+
 // show information related to the search such as the depth, nodes, time etc.
-void UCI::showSearchInfo(short depth, int nodes, int startTime, int score) {
+void UCI::showSearchInfo(short depth, long long nodes, long long startTime, int score) {
     // get current time
-    int currTime = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    long long currTime = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
 
     // if time is 0 then make it 1 so we wouldn't divide by 0
-    int time = (currTime == startTime ? 1 : currTime - startTime); 
+    long long time = (currTime == startTime ? 1 : currTime - startTime); 
 
     // nodes searched per second
     U64 nps =  1000LL*nodes/time;
 
-    std::cout << "info score " << scoreToStr(score) << " depth " << depth << " nodes " 
-         << nodes << " time " << time << " nps " << nps << " ";
+    std::cout << "info score " << scoreToStr(score) << " depth " << depth;
+#if SEARCH_STATS
+    std::cout << " seldepth " << Search::stats.selDepth;
+#endif
+    std::cout << " nodes " << nodes << " time " << time << " nps " << nps << " hashfull " << transpositionTable->hashfull() << " ";
     std::cout.flush();
 
     // print principal variation
     Search::showPV(depth);
+
+#if SEARCH_STATS
+    showSearchStats(depth);
+#endif
+}
+
+static double percent(long long part, long long total) {
+    return (total ? 100.0 * part / total : 0.0);
+}
+
+// the most useful counters of the current search, printed after every iteration
+void UCI::showSearchStats(short depth) {
+    const SearchStats &s = Search::stats;
+    long long prevNodes = (depth > 1 ? s.depthNodes[depth-1] : 0);
+
+    std::cout << fixed << setprecision(1) << "info string stats tt hit " << percent(s.ttHits, s.ttProbes)
+              << "% cut " << percent(s.ttCutoffs, s.ttProbes) << "% | first move fail high " << percent(s.firstMoveFailHighs, s.failHighs)
+              << "% | null " << percent(s.nullCutoffs, s.nullTries) << "% razor " << percent(s.razorCutoffs, s.razorTries)
+              << "% lmr research " << percent(s.lmrResearches, s.lmrTries) << "% | lazy eval " << percent(s.lazyEvalExits, s.lazyEvalCalls)
+              << "% | q/main " << (s.mainNodes ? (double)s.qNodes / s.mainNodes : 0.0)
+              << " | ebf " << (prevNodes ? (double)s.depthNodes[depth] / prevNodes : 0.0) << '\n';
+    std::cout << defaultfloat;
+    std::cout.flush();
+}
+
+// every counter of the last search, one per line, so that two runs can be compared with diff
+void UCI::printStats() {
+#if SEARCH_STATS
+    const SearchStats &s = Search::lastStats;
+
+    std::cout << fixed << setprecision(2);
+    std::cout << "depth " << s.depth << "\nseldepth " << s.selDepth << '\n';
+    std::cout << "main nodes " << s.mainNodes << "\nqsearch nodes " << s.qNodes
+              << "\nqsearch/main " << (s.mainNodes ? (double)s.qNodes / s.mainNodes : 0.0) << '\n';
+    std::cout << "tt probes " << s.ttProbes << " hits " << s.ttHits << " (" << percent(s.ttHits, s.ttProbes) << "%) cutoffs "
+              << s.ttCutoffs << " (" << percent(s.ttCutoffs, s.ttProbes) << "%)\n";
+    std::cout << "fail highs " << s.failHighs << " first move " << s.firstMoveFailHighs << " (" << percent(s.firstMoveFailHighs, s.failHighs) << "%)\n";
+    std::cout << "upcoming repetitions " << s.cycleDraws << " cutoffs " << s.cycleCutoffs << " (" << percent(s.cycleCutoffs, s.cycleDraws) << "%)\n";
+    std::cout << "static null tries " << s.staticNullTries << " cutoffs " << s.staticNullCutoffs << " (" << percent(s.staticNullCutoffs, s.staticNullTries) << "%)\n";
+    std::cout << "null move tries " << s.nullTries << " cutoffs " << s.nullCutoffs << " (" << percent(s.nullCutoffs, s.nullTries) << "%)\n";
+    std::cout << "razoring tries " << s.razorTries << " cutoffs " << s.razorCutoffs << " (" << percent(s.razorCutoffs, s.razorTries) << "%)\n";
+    std::cout << "futility nodes " << s.futilityNodes << " pruned moves " << s.futilityPrunes << '\n';
+    std::cout << "lmr tries " << s.lmrTries << " re-searches " << s.lmrResearches << " (" << percent(s.lmrResearches, s.lmrTries) << "%)\n";
+    std::cout << "pvs tries " << s.pvsTries << " re-searches " << s.pvsResearches << " (" << percent(s.pvsResearches, s.pvsTries) << "%)\n";
+    std::cout << "lazy eval calls " << s.lazyEvalCalls << " exits " << s.lazyEvalExits << " (" << percent(s.lazyEvalExits, s.lazyEvalCalls)
+              << "%) max positional term " << s.maxPositionalScore << '\n';
+    for(int d = 1; d <= s.depth; d++) {
+        std::cout << "iteration " << d << " nodes " << s.depthNodes[d];
+        if(d > 1 && s.depthNodes[d-1]) std::cout << " ebf " << (double)s.depthNodes[d] / s.depthNodes[d-1];
+        std::cout << '\n';
+    }
+    std::cout << defaultfloat;
+#else
+    std::cout << "info string search statistics are disabled, build with -DSEARCH_STATS=1\n";
+#endif
+    std::cout.flush();
 }
 
 // function that prints the current board
@@ -214,7 +518,13 @@ void UCI::inputGo() {
         std::unique_lock<std::mutex> lk(UCI::mtx);
         UCI::cv.wait(lk, []{ return UCI::startFlag || UCI::quitFlag; });
 
-        if(UCI::quitFlag) return;
+        if(UCI::quitFlag) {
+            // the trace is closed by the search thread, so that no search is writing to it
+#if SEARCH_TRACE
+            SearchTrace::close();
+#endif
+            return;
+        }
 
         UCI::startFlag = false;
 
@@ -223,7 +533,12 @@ void UCI::inputGo() {
         // do a perft and then continue if it is requested
         if(parsedInput[1] == "perft") {
             long long startTime = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
-            long long num = moveGenTest(stoi(parsedInput[2]), true);
+            // go perft <depth> [divide] [threads <n>], the count of every root move is always printed
+            int threads = max(1, (int)thread::hardware_concurrency());
+            for(unsigned int i = 3; i + 1 < parsedInput.size(); i++)
+                if(parsedInput[i] == "threads") threads = max(1, stoi(parsedInput[i+1]));
+
+            long long num = Perft::run(board, stoi(parsedInput[2]), true, threads);
             long long endTime = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
             long long time = max(1LL, endTime-startTime);
             long long nps = 1000LL*num/time;
@@ -298,7 +613,7 @@ void UCI::inputGo() {
         // set the stop time
         Search::stopTime = startTime + time + inc;
 
-        std::pair<int, int> searchResult = Search::root();
+        std::pair<Move, int> searchResult = Search::root();
         std::cout << "bestmove " << BoardUtils::moveToString(searchResult.first) << '\n';
         std::cout.flush();
     }
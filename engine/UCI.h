@@ -17,15 +17,24 @@ private:
     static std::string engineName;
 
 public:
+    static const short BENCH_DEPTH;
+
     static void UCICommunication();
     static void inputUCI();
     static void inputIsReady();
     static void inputUCINewGame();
     static void inputPosition(std::string input);
+    static void inputSetOption(std::string input);
     static void inputGo();
 
-    static void showSearchInfo(short depth, int nodes, int startTime, int score);
+    static void showSearchInfo(short depth, long long nodes, long long startTime, int score);
+    static void showSearchStats(short depth);
+    static void printStats();
     static long long moveGenTest(short depth, bool show);
+    static void sliderBench(short depth);
+    static long long makeUnmakeTest(short depth, int repeat);
+    static void makeBench(short depth);
+    static void bench(short depth, int hashMB, int threads);
     static void printBoard(bool chars);
     static void printEval();
 };
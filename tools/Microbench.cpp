@@ -0,0 +1,183 @@
+// microbenchmarks of the engine primitives over a fixed set of positions
+// usage: ciorap-microbench [samples] [name filter]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+#include "Board.h"
+#include "Evaluate.h"
+#include "MagicBitboardUtils.h"
+#include "MoveUtils.h"
+
+using namespace std;
+
+// openings, middlegames and endgames, with and without castling rights, checks and en passant
+static const vector<string> corpus = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/8 b - - 3 54",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "8/8/8/8/8/4k3/4P3/4K3 w - - 0 1"
+};
+
+static const int MIN_SAMPLE_NS = 20000000; // every sample runs the benchmark for at least 20 ms
+
+static U64 sink; // the results of the primitives are added here so that the calls aren't optimized away
+
+// a benchmark runs its primitive over the whole corpus once and returns the number of operations
+struct Benchmark {
+    string name;
+    function<long long()> run;
+};
+
+static vector<Board*> boards;
+static vector<vector<Move>> legalMoves; // of every board, generated once so that make/unmake is timed alone
+static Board *fenBoard; // loadFenPos gets its own board, so that the corpus isn't changed
+
+static void runBenchmark(const Benchmark &bench, int samples) {
+    // find how many rounds make a sample long enough
+    long long rounds = 1;
+    while(true) {
+        auto start = chrono::steady_clock::now();
+        for(long long r = 0; r < rounds; r++) bench.run();
+        long long ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        if(ns >= MIN_SAMPLE_NS) break;
+        rounds *= 2;
+    }
+
+    vector<double> nsPerOp;
+    for(int s = 0; s < samples; s++) {
+        long long ops = 0;
+        auto start = chrono::steady_clock::now();
+        for(long long r = 0; r < rounds; r++) ops += bench.run();
+        long long ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        nsPerOp.push_back((double)ns / ops);
+    }
+
+    sort(nsPerOp.begin(), nsPerOp.end());
+    double mean = 0, variance = 0;
+    for(double x: nsPerOp) mean += x;
+    mean /= samples;
+    for(double x: nsPerOp) variance += (x - mean) * (x - mean);
+    double stddev = sqrt(variance / max(1, samples - 1));
+
+    cout << left << setw(26) << bench.name << right << fixed << setprecision(2)
+         << " median " << setw(9) << nsPerOp[samples / 2] << " ns/op"
+         << "  min " << setw(9) << nsPerOp[0]
+         << "  mean " << setw(9) << mean << " +- " << setw(6) << stddev << '\n';
+}
+
+int main(int argc, char **argv) {
+    int samples = (argc > 1 ? max(1, stoi(argv[1])) : 15);
+    string filter = (argc > 2 ? argv[2] : "");
+
+    init();
+
+    for(const string &fen: corpus) {
+        boards.push_back(new Board());
+        boards.back()->loadFenPos(fen);
+
+        Move moves[256];
+        int num = boards.back()->generateLegalMoves(moves);
+        legalMoves.push_back(vector<Move>(moves, moves + num));
+    }
+    board = boards[0];
+    fenBoard = new Board();
+
+    vector<Benchmark> benchmarks = {
+        {"magicRookAttacks", []() {
+            long long ops = 0;
+            for(Board *b: boards) {
+                U64 occ = b->occupiedBB();
+                for(int sq = 0; sq < 64; sq++) sink += MagicBitboardUtils::magicRookAttacks(occ, sq);
+                ops += 64;
+            }
+            return ops;
+        }},
+        {"magicBishopAttacks", []() {
+            long long ops = 0;
+            for(Board *b: boards) {
+                U64 occ = b->occupiedBB();
+                for(int sq = 0; sq < 64; sq++) sink += MagicBitboardUtils::magicBishopAttacks(occ, sq);
+                ops += 64;
+            }
+            return ops;
+        }},
+        {"generateLegalMoves", []() {
+            Move moves[256];
+            for(Board *b: boards) sink += b->generateLegalMoves(moves);
+            return (long long)boards.size();
+        }},
+        {"generateLegalMovesQS", []() {
+            Move moves[256];
+            for(Board *b: boards) sink += b->generateLegalMovesQS(moves);
+            return (long long)boards.size();
+        }},
+        {"makeMove+unmakeMove", []() {
+            long long ops = 0;
+            for(unsigned int i = 0; i < boards.size(); i++) {
+                for(Move move: legalMoves[i]) {
+                    boards[i]->makeMove(move);
+                    sink += boards[i]->hashKey;
+                    boards[i]->unmakeMove(move);
+                }
+                ops += legalMoves[i].size();
+            }
+            return ops;
+        }},
+        {"isAttacked", []() {
+            long long ops = 0;
+            for(Board *b: boards) {
+                for(int sq = 0; sq < 64; sq++) sink += b->isAttacked(sq);
+                ops += 64;
+            }
+            return ops;
+        }},
+        {"isInCheck", []() {
+            for(Board *b: boards) sink += b->isInCheck();
+            return (long long)boards.size();
+        }},
+        {"evaluate", []() {
+            for(Board *b: boards) {
+                board = b;
+                sink += evaluate();
+            }
+            return (long long)boards.size();
+        }},
+        {"getZobristHashFromCurrPos", []() {
+            for(Board *b: boards) sink += b->getZobristHashFromCurrPos();
+            return (long long)boards.size();
+        }},
+        {"loadFenPos", []() {
+            for(const string &fen: corpus) {
+                fenBoard->loadFenPos(fen);
+                sink += fenBoard->hashKey;
+            }
+            return (long long)corpus.size();
+        }}
+    };
+
+    cout << "positions " << corpus.size() << " samples " << samples << " sliders " << (MagicBitboardUtils::usePext ? "pext" : "magic") << '\n';
+    for(const Benchmark &bench: benchmarks) {
+        if(bench.name.find(filter) == string::npos) continue;
+        runBenchmark(bench, samples);
+    }
+    cout << "checksum " << sink << '\n';
+
+    return 0;
+}
@@ -0,0 +1,179 @@
+// reads a search trace (written by a SEARCH_TRACE build after the trace command) and prints how the tree was cut
+// usage: ciorap-tree-analyser <trace file> [examples]
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+
+#include "SearchTrace.h"
+#include "BoardUtils.h"
+
+using namespace std;
+
+static const int MAX_DEPTH = 64, MAX_INDEX = 16;
+
+static const char *PRUNING_NAMES[TRACE_PRUNES] = {
+    "none", "mate distance", "draw", "tt", "no moves", "horizon", "static null", "null move", "razoring"
+};
+
+struct DepthStats {
+    long long nodes, pvNodes, searched, failHighs, firstMoveFailHighs, futilityPrunes;
+    long long pruned[TRACE_PRUNES];
+};
+
+// a reduced or null window search, and what the search of the same move with more depth or a wider window found
+struct Resolution {
+    long long tries, beatAlpha, confirmed, refuted;
+};
+
+static double percent(long long part, long long total) {
+    return (total ? 100.0 * part / total : 0.0);
+}
+
+// the window of a child is the negated window of its parent, so the move beat the alpha of the parent
+// if the child scored below its beta (for null window and full window children alike)
+static bool beatsParentAlpha(const TraceRecord &child) {
+    return (child.score < child.beta);
+}
+
+int main(int argc, char **argv) {
+    if(argc < 2) {
+        cout << "usage: ciorap-tree-analyser <trace file> [examples]\n";
+        return 1;
+    }
+    unsigned int maxExamples = (argc > 2 ? stoi(argv[2]) : 10);
+
+    FILE *file = fopen(argv[1], "rb");
+    char magic[sizeof(TRACE_MAGIC)];
+    if(file == nullptr || fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, TRACE_MAGIC, sizeof(magic))) {
+        cout << "could not read a search trace from " << argv[1] << '\n';
+        return 1;
+    }
+
+    vector<DepthStats> depths(MAX_DEPTH + 1);
+    long long failHighIndex[MAX_INDEX + 1] = {}, kinds[TRACE_IID + 1] = {};
+    long long records = 0, roots = 0, totalFailHighs = 0;
+
+    vector<Resolution> lmr(MAX_DEPTH + 1); // indexed by the reduction
+    Resolution pvs = {};
+    vector<TraceRecord> wrongReductions, wrongNullWindows;
+
+    // the last reduced or null window child of every node that is still being searched
+    unordered_map<uint32_t, TraceRecord> pending;
+
+    vector<TraceRecord> buffer(1 << 15);
+    size_t count;
+    while((count = fread(buffer.data(), sizeof(TraceRecord), buffer.size(), file)) > 0) {
+        for(size_t i = 0; i < count; i++) {
+            const TraceRecord &r = buffer[i];
+            records++;
+            kinds[min((int)r.kind, (int)TRACE_IID)]++;
+            if(r.kind == TRACE_ROOT) roots++;
+
+            DepthStats &d = depths[max(0, min((int)r.depth, MAX_DEPTH))];
+            d.nodes++;
+            d.pvNodes += r.isPV;
+            d.pruned[min((int)r.pruning, TRACE_PRUNES - 1)]++;
+            d.futilityPrunes += r.futilityPrunes;
+            if(r.pruning == TRACE_PRUNE_NONE) d.searched++;
+            if(r.failHighIndex != 255) {
+                d.failHighs++;
+                d.firstMoveFailHighs += (r.failHighIndex == 0);
+                failHighIndex[min((int)r.failHighIndex, MAX_INDEX)]++;
+                totalFailHighs++;
+            }
+
+            // the children of this node are done
+            pending.erase(r.id);
+
+            if(r.kind == TRACE_LMR) {
+                Resolution &res = lmr[min((int)r.reduction, MAX_DEPTH)];
+                res.tries++;
+                res.beatAlpha += beatsParentAlpha(r);
+            }
+            if(r.kind == TRACE_NULL_WINDOW) pvs.tries++;
+
+            auto it = pending.find(r.parent);
+            if(it != pending.end() && it->second.move == r.move) {
+                const TraceRecord &prev = it->second;
+
+                // a reduced search that beat alpha, searched again with the full depth
+                if(prev.kind == TRACE_LMR && r.kind == TRACE_NULL_WINDOW) {
+                    Resolution &res = lmr[min((int)prev.reduction, MAX_DEPTH)];
+                    if(beatsParentAlpha(r)) res.confirmed++;
+                    else {
+                        res.refuted++;
+                        if(wrongReductions.size() < maxExamples) wrongReductions.push_back(prev);
+                    }
+                }
+
+                // a null window search that landed inside the window, searched again with the full window
+                if(prev.kind == TRACE_NULL_WINDOW && r.kind == TRACE_PV_RESEARCH) {
+                    pvs.beatAlpha++;
+                    if(beatsParentAlpha(r)) pvs.confirmed++;
+                    else {
+                        pvs.refuted++;
+                        if(wrongNullWindows.size() < maxExamples) wrongNullWindows.push_back(prev);
+                    }
+                }
+            }
+            if(r.kind == TRACE_LMR || r.kind == TRACE_NULL_WINDOW) pending[r.parent] = r;
+        }
+    }
+    fclose(file);
+
+    cout << "nodes " << records << " iterations " << roots << '\n';
+    cout << "children: first move " << kinds[TRACE_FIRST_MOVE] << " lmr " << kinds[TRACE_LMR] << " null window " << kinds[TRACE_NULL_WINDOW]
+         << " pv re-search " << kinds[TRACE_PV_RESEARCH] << " null move " << kinds[TRACE_NULL_MOVE] << " iid " << kinds[TRACE_IID] << "\n\n";
+
+    cout << fixed << setprecision(1);
+    // one column for every way a node can end before its moves are searched (the share of the nodes of the depth)
+    cout << "depth      nodes   pv%  searched  fail high%  first move%";
+    for(int p = TRACE_PRUNE_NONE + 1; p < TRACE_PRUNES; p++) cout << "  " << PRUNING_NAMES[p] << '%';
+    cout << "  futility/node\n";
+    for(int depth = 0; depth <= MAX_DEPTH; depth++) {
+        const DepthStats &d = depths[depth];
+        if(!d.nodes) continue;
+        cout << setw(5) << depth << setw(11) << d.nodes << setw(6) << percent(d.pvNodes, d.nodes) << setw(10) << d.searched
+             << setw(12) << percent(d.failHighs, d.searched) << setw(13) << percent(d.firstMoveFailHighs, d.failHighs);
+        for(int p = TRACE_PRUNE_NONE + 1; p < TRACE_PRUNES; p++) cout << setw(strlen(PRUNING_NAMES[p]) + 3) << percent(d.pruned[p], d.nodes);
+        cout << setw(15) << (d.searched ? (double)d.futilityPrunes / d.searched : 0.0) << '\n';
+    }
+
+    cout << "\nfail highs by move index\n";
+    long long cumulative = 0;
+    for(int idx = 0; idx <= MAX_INDEX; idx++) {
+        if(!failHighIndex[idx]) continue;
+        cumulative += failHighIndex[idx];
+        cout << setw(4) << idx << (idx == MAX_INDEX ? "+" : " ") << setw(11) << failHighIndex[idx] << setw(7) << percent(failHighIndex[idx], totalFailHighs)
+             << "%  cumulative " << setw(5) << percent(cumulative, totalFailHighs) << "%\n";
+    }
+
+    cout << "\nlmr by reduction: tries, beat alpha, confirmed at full depth, refuted at full depth\n";
+    for(int red = 0; red <= MAX_DEPTH; red++) {
+        const Resolution &res = lmr[red];
+        if(!res.tries) continue;
+        cout << setw(4) << red << setw(11) << res.tries << setw(11) << res.beatAlpha << " (" << percent(res.beatAlpha, res.tries) << "%)"
+             << setw(11) << res.confirmed << setw(11) << res.refuted << " (" << percent(res.refuted, res.confirmed + res.refuted) << "%)\n";
+    }
+
+    cout << "\npvs: null window searches " << pvs.tries << ", inside the window " << pvs.beatAlpha << " (" << percent(pvs.beatAlpha, pvs.tries)
+         << "%), confirmed by the full window " << pvs.confirmed << ", refuted " << pvs.refuted << " (" << percent(pvs.refuted, pvs.beatAlpha) << "%)\n";
+
+    // the reduced searches that beat alpha but not at full depth (so the re-search was wasted)
+    if(!wrongReductions.empty()) cout << "\nwrong reductions (node, ply, depth, reduction, move)\n";
+    for(const TraceRecord &r: wrongReductions)
+        cout << "  " << r.id << " ply " << (int)r.ply << " depth " << (int)r.depth << " reduction " << (int)r.reduction
+             << " move " << BoardUtils::moveToString(r.move) << '\n';
+
+    if(!wrongNullWindows.empty()) cout << "\nwrong null window searches (node, ply, depth, move)\n";
+    for(const TraceRecord &r: wrongNullWindows)
+        cout << "  " << r.id << " ply " << (int)r.ply << " depth " << (int)r.depth << " move " << BoardUtils::moveToString(r.move) << '\n';
+
+    return 0;
+}